@@ -21,10 +21,26 @@
 
 #include "lconf/json_token.h"
 #include "lconf/json_lexer.h"
+#include "lconf/json_buffer.h"
+#include "lconf/json_writer.h"
 #include "lconf/json_node.h"
 #include "lconf/json_parser.h"
+#include "lconf/json_status.h"
 #include "lconf/json_template.h"
+#include "lconf/json_struct.h"
+#include "lconf/json_incremental.h"
+#include "lconf/json_codec.h"
+#include "lconf/json_binary.h"
+#include "lconf/json_snapshot.h"
+#include "lconf/json_cache.h"
+#include "lconf/json_file.h"
+#include "lconf/json_path.h"
+#include "lconf/json_index.h"
+#include "lconf/json_patch.h"
+#include "lconf/json_value.h"
+#include "lconf/json_layers.h"
 #include <string>
+#include <vector>
 #include <iostream>
 
 namespace lconf { namespace json
@@ -32,14 +48,53 @@ namespace lconf { namespace json
     Node* parse(std::string const& file);
     Node* parse(std::istream& file);
 
-    void serialize(Node* node, std::string const& file, bool indent = true);
+    //! flags is a combination of WriteFlags (see json_file.h).
+    void serialize(Node* node, std::string const& file, bool indent = true, int flags = 0);
     void serialize(Node* node, std::ostream& file, bool indent = true);
+    void serialize(Node* node, std::string const& file, Format format, int flags = 0);
+    void serialize(Node* node, std::ostream& file, Format format);
 
     void extract(Template const& tpl, std::string const& file);
     void extract(Template const& tpl, std::istream& file);
 
-    void synthetize(Template const& tpl, std::string const& file, bool indent = true);
+    //! Non-throwing variants of parse() and extract() : they return
+    //!   0 or false on failure, with the error described by status
+    //!   (see Status), which is reset otherwise.
+    //! No exception is involved on the failure path, except those
+    //!   thrown by user elements.
+    Node* tryParse(std::string const& file, Status& status);
+    Node* tryParse(std::istream& file, Status& status);
+    bool tryExtract(Template const& tpl, std::string const& file, Status& status);
+    bool tryExtract(Template const& tpl, std::istream& file, Status& status);
+
+    //! Bulk validation : parse in recovery mode (see Parser), then
+    //!   extract what could be parsed, going on after errors. All the
+    //!   syntax errors, then all the extraction errors, are stored in
+    //!   errors, and true is returned if there is none.
+    //! Values left out because of a syntax error may be reported again
+    //!   as missing by the extraction.
+    bool validate(Template const& tpl, std::string const& file, std::vector<Status>& errors);
+    bool validate(Template const& tpl, std::istream& file, std::vector<Status>& errors);
+
+    void synthetize(Template const& tpl, std::string const& file, bool indent = true, int flags = 0);
     void synthetize(Template const& tpl, std::ostream& file, bool indent = true);
+    //! The canonical format goes through the synthetized tree, so that
+    //!   structure fields are sorted as well.
+    void synthetize(Template const& tpl, std::string const& file, Format format, int flags = 0);
+    void synthetize(Template const& tpl, std::ostream& file, Format format);
+
+    //! Binary variants of the above (see json_binary.h).
+    Node* parseBinary(std::string const& file);
+    Node* parseBinary(std::istream& file);
+
+    void serializeBinary(Node* node, std::string const& file, int flags = 0);
+    void serializeBinary(Node* node, std::ostream& file);
+
+    void extractBinary(Template const& tpl, std::string const& file);
+    void extractBinary(Template const& tpl, std::istream& file);
+
+    void synthetizeBinary(Template const& tpl, std::string const& file, int flags = 0);
+    void synthetizeBinary(Template const& tpl, std::ostream& file);
 } }
 
 #endif // LCONF_JSON_H
@@ -0,0 +1,75 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_BINARY_H
+#define LCONF_JSON_BINARY_H
+
+#include "lconf/json_node.h"
+#include "lconf/json_buffer.h"
+#include <string>
+#include <iostream>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Binary encoding of JSON trees.
+    //! A document is the 4 bytes magic "LCB1" followed by the root
+    //!   value. Each value starts with a one byte tag (see BinaryTag),
+    //!   and all sizes and integers are LEB128 varints (zigzag encoded
+    //!   for signed integers). Floating-point numbers are stored as
+    //!   little-endian IEEE 754 values, and packed arrays are stored as
+    //!   is, so that they are copied back with a single memcpy().
+    enum BinaryTag
+    {
+        //! No payload.
+        BinaryFalse = 0x00,
+        BinaryTrue = 0x01,
+        //! Integral number, below 2^53 in magnitude (signed varint).
+        BinaryInteger = 0x02,
+        //! Double precision number (8 bytes).
+        BinaryDouble = 0x03,
+        //! Single precision number (4 bytes, see NumberNode).
+        BinarySingle = 0x04,
+        //! Byte count, followed by the UTF-8 bytes.
+        BinaryString = 0x05,
+        //! Entry count, followed by (key length, key bytes, value) entries.
+        BinaryObject = 0x06,
+        //! Element count, followed by the values.
+        BinaryArray = 0x07,
+        //! Packed arrays (see ArrayNode), element count followed by
+        //!   signed varints, doubles, floats, or a bitmap of booleans
+        //!   (least significant bit first).
+        BinaryIntegers = 0x08,
+        BinaryDoubles = 0x09,
+        BinarySingles = 0x0A,
+        BinaryBooleans = 0x0B,
+        //! No payload.
+        BinaryNull = 0x0C
+    };
+
+    //! Write the binary encoding of the tree whose root is node.
+    void encodeBinary(Node const* node, Buffer& out);
+    //! Decode a binary document of size bytes.
+    //! Throws a std::logic_error if the data is malformed, or nests
+    //!   objects and arrays more than 1024 levels deep.
+    Node* decodeBinary(char const* data, std::size_t size);
+    //! Decode a binary document read until the end of the given stream.
+    Node* decodeBinary(std::istream& in);
+} }
+
+#endif // LCONF_JSON_BINARY_H
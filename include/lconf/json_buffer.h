@@ -0,0 +1,100 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_BUFFER_H
+#define LCONF_JSON_BUFFER_H
+
+#include "lconf/json_number.h"
+#include <string>
+#include <iostream>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Contiguous output buffer used by the serializer.
+    //! A buffer either keeps all of its contents in memory, or is
+    //!   attached to an output stream to which it hands its contents
+    //!   over in large chunks (the stream is never explicitly flushed).
+    class Buffer
+    {
+    public:
+        //! Create an in-memory buffer.
+        Buffer();
+        //! Create a buffer writing to the given stream.
+        Buffer(std::ostream& out);
+        ~Buffer();
+        
+        void put(char c);
+        void write(char const* data, std::size_t size);
+        void write(std::string const& str);
+        //! Write level spaces.
+        void indent(int level);
+        //! Write a number (see formatNumber()).
+        void number(double value, bool single = false);
+        //! Write the contents of a JSON string, escaping double quotes,
+        //!   backslashes and control characters.
+        //! Runs of characters needing no escape are written in bulk.
+        void escaped(char const* data, std::size_t size);
+        
+        //! Hand the pending contents over to the output stream, if any.
+        void flush();
+        
+        //! Get the size of the pending contents (which is the
+        //!   position in the output for in-memory buffers).
+        std::size_t size() const;
+
+        //! Get the buffered contents (for in-memory buffers).
+        std::string const& str() const;
+        std::string& str();
+        
+    private:
+        //! Size above which stream-backed buffers hand their
+        //!   contents over to the stream.
+        enum { ChunkSize = 1 << 16 };
+        
+    private:
+        std::ostream* m_out;
+        std::string m_data;
+    };
+    
+    inline void Buffer::put(char c)
+    {
+        m_data += c;
+        if (m_out && m_data.size() >= ChunkSize) flush();
+    }
+    
+    inline void Buffer::write(char const* data, std::size_t size)
+    {
+        m_data.append(data, size);
+        if (m_out && m_data.size() >= ChunkSize) flush();
+    }
+    
+    inline std::size_t Buffer::size() const
+    { return m_data.size(); }
+    
+    inline void Buffer::write(std::string const& str)
+    { write(str.data(), str.size()); }
+    
+    inline void Buffer::number(double value, bool single)
+    {
+        char str[NumberLength];
+        write(str, formatNumber(value, str, single));
+    }
+} }
+
+#endif // LCONF_JSON_BUFFER_H
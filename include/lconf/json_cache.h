@@ -0,0 +1,52 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_CACHE_H
+#define LCONF_JSON_CACHE_H
+
+#include "lconf/json_node.h"
+#include "lconf/json_status.h"
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace lconf { namespace json
+{
+    //! Make json::parse(file) (and thus json::extract(tpl, file))
+    //!   consult a cache of compiled configurations stored in dir.
+    //! Cache entries are named after a fingerprint of the file contents,
+    //!   and record the fingerprints of all the included files, so that
+    //!   an entry is only used if none of these files changed. Entries
+    //!   hold the binary form of the tree (see json_binary.h).
+    //! On a miss, or if the cache is unusable, the text is parsed as
+    //!   usual and a new entry is written (cache errors are ignored).
+    //! This setting is process-wide, and not thread-safe.
+    void enableCache(std::string const& dir);
+    void disableCache();
+    bool cacheEnabled();
+
+    //! Parse the given text file through the cache (see above).
+    Node* parseCached(std::string const& file);
+    //! Non-throwing variant (see tryParse()).
+    Node* parseCached(std::string const& file, Status& status);
+
+    //! 64 bits FNV-1a hash of size bytes.
+    uint64_t fingerprint(char const* data, std::size_t size);
+} }
+
+#endif // LCONF_JSON_CACHE_H
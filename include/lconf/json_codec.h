@@ -0,0 +1,76 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_CODEC_H
+#define LCONF_JSON_CODEC_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace lconf { namespace json
+{
+    //! Binary-to-text encodings, used to store
+    //!   binary data in JSON strings.
+    enum Encoding
+    {
+        //! Lowercase hexadecimal digits (100% overhead).
+        Hex,
+        //! RFC 4648 base64, padded (33% overhead).
+        Base64,
+        //! RFC 4648 URL and filename safe base64, not padded.
+        Base64Url
+    };
+
+    //! Encode size bytes with the given encoding.
+    std::string encode(Encoding encoding, void const* data, std::size_t size);
+    //! Compute the size of the data encoded in str.
+    //! Returns false if str has an impossible length for the encoding.
+    bool decodedSize(Encoding encoding, std::string const& str, std::size_t& size);
+    //! Decode str into out, which must have room for decodedSize() bytes.
+    //! Returns false if str is malformed, in which case the contents
+    //!   of out are unspecified.
+    bool decode(Encoding encoding, std::string const& str, void* out);
+
+    //! Encode size bytes as a lowercase hexadecimal string
+    //!   (two digits per byte, most significant nibble first).
+    std::string hexEncode(void const* data, std::size_t size);
+    //! Encode size bytes to out, which must have room
+    //!   for 2*size characters.
+    void hexEncode(uint8_t const* data, std::size_t size, char* out);
+
+    //! Decode 2*size hexadecimal digits (of any case) into size bytes.
+    //! Returns false if a non-hexadecimal character is encountered,
+    //!   in which case the contents of out are unspecified.
+    bool hexDecode(char const* in, std::size_t size, uint8_t* out);
+
+    //! Encode size bytes in base64 (see Encoding).
+    std::string base64Encode(void const* data, std::size_t size, bool url = false);
+    //! Encode size bytes to out, which must have room for
+    //!   4*((size+2)/3) characters.
+    //! Returns the number of characters written.
+    std::size_t base64Encode(uint8_t const* data, std::size_t size, char* out, bool url = false);
+
+    //! Decode length base64 characters (padding excluded) into
+    //!   out, which must have room for (3*length)/4 bytes.
+    //! Returns false if a character outside of the alphabet is
+    //!   encountered, in which case the contents of out are unspecified.
+    bool base64Decode(char const* in, std::size_t length, uint8_t* out, bool url = false);
+} }
+
+#endif // LCONF_JSON_CODEC_H
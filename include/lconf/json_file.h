@@ -0,0 +1,46 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_FILE_H
+#define LCONF_JSON_FILE_H
+
+#include <string>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Flags of the functions writing files.
+    enum WriteFlags
+    {
+        //! Write to a temporary file of the same directory, renamed over
+        //!   the target once complete: readers see either the old or the
+        //!   new contents, never a partial file, even after a crash.
+        Atomic = 1,
+        //! Flush the data to the storage device before returning (and
+        //!   the directory entry too, with Atomic).
+        Sync = 2
+    };
+
+    //! Write size bytes to file, with a single write() call when the
+    //!   system permits, according to flags.
+    //! Throws a std::logic_error on failure, in which case the target
+    //!   is left untouched with Atomic.
+    void writeFile(std::string const& file, char const* data, std::size_t size, int flags = Atomic);
+} }
+
+#endif // LCONF_JSON_FILE_H
@@ -0,0 +1,62 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_INCREMENTAL_H
+#define LCONF_JSON_INCREMENTAL_H
+
+#include "lconf/json_template.h"
+#include "lconf/json_file.h"
+#include <string>
+#include <iostream>
+
+namespace lconf { namespace json
+{
+    //! Incremental synthetization of a template.
+    //! The output of each leaf of the template (scalar, POD, raw data
+    //!   or numeric vector) is remembered along with a copy of the data
+    //!   it was written from. When the template is synthetized again,
+    //!   leaves whose data did not change are copied from the previous
+    //!   output instead of being formatted again.
+    //! User elements are always written (see Element::write()).
+    class Incremental
+    {
+    public:
+        Incremental(Template const& tpl, bool indent = true);
+        ~Incremental();
+
+        //! Synthetize the template, returning the output.
+        std::string const& synthetize();
+        void synthetize(std::ostream& out);
+        //! flags is a combination of WriteFlags.
+        void synthetize(std::string const& file, int flags = 0);
+
+        //! Get the output of the last synthetization.
+        std::string const& str() const;
+        //! Forget the previous output (the next synthetization
+        //!   formats everything).
+        void reset();
+
+    private:
+        Template m_tpl;
+        bool m_indent;
+        Fragment m_root;
+        std::string m_output;
+    };
+} }
+
+#endif // LCONF_JSON_INCREMENTAL_H
@@ -0,0 +1,76 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_INDEX_H
+#define LCONF_JSON_INDEX_H
+
+#include "lconf/json_node.h"
+#include "lconf/json_path.h"
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Index of all the nodes of a tree by JSON pointer.
+    //! Lookups are a single hash probe, whatever the depth of the node.
+    //!   Keys are the canonical pointers of the nodes (see Path), so
+    //!   pointers with escapes must be spelled as RFC 6901 mandates.
+    //! The index is built on the first lookup, and rebuilt on the next
+    //!   lookup whenever the structure of the tree may have changed (see
+    //!   Node::generation()), changes made to other trees being ignored.
+    //!   Packed arrays stay packed, their elements being indexed through
+    //!   ArrayNode::at() const.
+    //! The whole index is rebuilt after a change, so the nodes found
+    //!   should be read through const pointers : the non-const accessors
+    //!   count as changes, for instance in
+    //!     Node const* node = index.find("/a");
+    //!     Node const* b = node->downcast<ObjectNode>()->get("b");
+    //! The tree must outlive the index.
+    class Index
+    {
+    public:
+        explicit Index(Node* root);
+
+        //! Get the node at the given pointer, or 0.
+        Node* find(std::string const& pointer) const;
+        //! Same as above, paths that are not plain pointers are
+        //!   evaluated against the tree (see Path::find()).
+        Node* find(Path const& path) const;
+        bool exists(std::string const& pointer) const;
+
+        //! Get the number of indexed nodes.
+        std::size_t size() const;
+        Node* root() const;
+
+        //! Build the index now, rather than on the next lookup.
+        void rebuild() const;
+
+    private:
+        void M_check() const;
+        void M_index(Node* node, std::string& pointer) const;
+
+    private:
+        Node* m_root;
+        mutable std::unordered_map<std::string, Node*> m_nodes;
+        mutable unsigned long m_generation;
+        mutable bool m_built;
+    };
+} }
+
+#endif // LCONF_JSON_INDEX_H
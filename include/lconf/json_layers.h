@@ -0,0 +1,137 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_LAYERS_H
+#define LCONF_JSON_LAYERS_H
+
+#include "lconf/json_node.h"
+#include "lconf/json_path.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    class Layers;
+
+    //! Read-only view of a value of layered configurations, as if the
+    //!   layers were merged (see Layers), without merging them.
+    //! Overlays point to the nodes of the layers, and are valid as long
+    //!   as the layers they come from.
+    class Overlay
+    {
+    public:
+        Overlay();
+
+        //! Tell if the value exists in any layer.
+        bool exists() const;
+        Node::Type type() const;
+        //! Get the topmost node of the value (which is its whole value,
+        //!   unless it is an object or array merged with lower layers).
+        Node const* node() const;
+
+        //! Keys of a merged object, sorted.
+        std::vector<std::string> keys() const;
+        bool exists(std::string const& key) const;
+        //! Throws a std::domain_error if there is no such entry.
+        Overlay get(std::string const& key) const;
+        //! Number of entries of an object, or elements of an array.
+        std::size_t size() const;
+        //! Get the i-th element of a (possibly appended) array.
+        Overlay at(std::size_t i) const;
+        //! Get the value at path (a plain pointer), returning false
+        //!   if there is none.
+        bool find(Path const& path, Overlay& value) const;
+
+        //! Build the merged tree of this value.
+        Node* materialize() const;
+
+    private:
+        friend class Layers;
+
+        Overlay(Layers const* layers, std::vector<std::string> const& path);
+
+        void M_resolve(std::vector<Node const*> const& candidates);
+
+    private:
+        Layers const* m_layers;
+        std::vector<std::string> m_path;
+        //! Contributing nodes, from the lowest to the topmost layer.
+        std::vector<Node const*> m_nodes;
+    };
+
+    //! Layered configurations (defaults, site, host, command line...).
+    //! Values of upper layers take precedence over the ones of lower
+    //!   layers, depending on the strategy of their path :
+    //!   - Replace : the topmost value replaces the others,
+    //!   - Merge (default) : objects are merged key by key (other values
+    //!     being replaced),
+    //!   - Append : arrays are concatenated, from the lowest layer up
+    //!     (other values being replaced).
+    //! Layers are shared rather than copied (see Node::share()), so that
+    //!   any number of Layers can use the same base trees.
+    class Layers
+    {
+    public:
+        enum Strategy
+        {
+            Replace,
+            Merge,
+            Append
+        };
+
+    public:
+        Layers();
+        Layers(Layers const& other);
+        Layers& operator=(Layers const& other);
+        ~Layers();
+
+        //! Add a layer on top of the others.
+        //! The layer is shared (see Node::share()) rather than copied: the
+        //!   caller keeps its reference, but must then give it up with
+        //!   Node::release() instead of delete, which would destroy the
+        //!   tree while the Layers still use it. Changes made to the tree
+        //!   afterwards show through the Layers.
+        Layers& push(Node* layer);
+        std::size_t size() const;
+
+        //! Set the strategy of the values at path (a JSON pointer whose
+        //!   "*" segments match any key or index).
+        Layers& strategy(std::string const& path, Strategy strategy);
+        Strategy strategy(std::vector<std::string> const& path) const;
+
+        //! View the merged configuration.
+        Overlay root() const;
+        bool find(Path const& path, Overlay& value) const;
+        //! Build the merged configuration.
+        Node* merge() const;
+
+    private:
+        struct Rule
+        {
+            Path path;
+            Strategy strategy;
+        };
+
+    private:
+        std::vector<Node*> m_layers;
+        std::vector<Rule> m_rules;
+    };
+} }
+
+#endif // LCONF_JSON_LAYERS_H
@@ -21,24 +21,49 @@
 
 #include "lconf/json_token.h"
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cstddef>
 
 namespace lconf { namespace json
 {
     class Lexer
     {
     public:
+        //! Lex a stream, reading it as the tokens are needed : the
+        //!   stream is left right after the last token extracted by
+        //!   get() (so that a value can be parsed off a live stream,
+        //!   the data following it being left for the caller).
         Lexer(std::istream& in);
+        //! Lex size bytes at data, in place (the data must
+        //!   outlive the lexer).
+        Lexer(char const* data, std::size_t size);
         ~Lexer();
         
         //! Get the next token from the input stream.
         Token get();
         //! Seek for the next token in the input stream
         //!   (but do NOT extract it).
-        Token const& seek() const;
+        Token const& seek();
+
+        //! Get the line and column (starting at 1) of a token offset.
+        //! Positions are only needed for diagnostics, so they are
+        //!   computed on demand, from an index of the line starts
+        //!   recorded while reading a stream, or built by the first
+        //!   call when lexing from memory.
+        void position(std::size_t offset, std::size_t& line, std::size_t& column) const;
         
     private:
+        Lexer(Lexer const&);
+        Lexer& operator=(Lexer const&);
+
         void M_init();
         int M_getChar();
+        int M_eat();
+        void M_peek();
+        std::size_t M_offset() const;
+        bool M_unicode(std::string& value);
+        bool M_hex4(unsigned int& cp);
         void M_skipWs();
         void M_skipComments();
         void M_skip();
@@ -47,11 +72,21 @@ namespace lconf { namespace json
         Token M_matchKeyword(Token::Type type, std::string const& kw);
         
     private:
-        std::istream& m_in;
+        //! Input stream, or 0 when lexing from memory.
+        std::istream* m_in;
+        char const* m_begin;
+        char const* m_end;
+        //! Position of m_nextChar, in memory.
+        char const* m_ptr;
+        //! Offset of m_nextChar, in a stream.
+        std::size_t m_offset;
         
         int m_nextChar;
         Token m_nextToken;
-        Token::Info m_currentInfo;
+        //! Tell if m_nextToken was read.
+        bool m_ready;
+        //! Offsets of the line starts (see position()).
+        mutable std::vector<std::size_t> m_lines;
     };
 } }
 
@@ -19,10 +19,14 @@
 #ifndef LCONF_JSON_NODE_H
 #define LCONF_JSON_NODE_H
 
+#include "lconf/json_buffer.h"
+#include "lconf/json_writer.h"
 #include <string>
 #include <map>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include <cstdint>
 
 namespace lconf { namespace json
 {
@@ -31,6 +35,7 @@ namespace lconf { namespace json
     class StringNode;
     class ObjectNode;
     class ArrayNode;
+    class NullNode;
     
     class Node
     {
@@ -38,6 +43,8 @@ namespace lconf { namespace json
         //!   M_serialize() and M_multiline().
         friend class ObjectNode;
         friend class ArrayNode;
+        friend class Writer;
+        friend bool equal(Node const* a, Node const* b);
     public:
         enum Type
         {
@@ -45,11 +52,14 @@ namespace lconf { namespace json
             Boolean,
             String,
             Object,
-            Array
+            Array,
+            Null
         };
         
     protected:
-        Node() {}
+        Node() :
+            m_owners(1)
+        {}
         
     public:
         virtual ~Node() {}
@@ -63,14 +73,93 @@ namespace lconf { namespace json
         //! If indent == false, no indentation is outputted
         //!   (and you get a compact, single-line output).
         void serialize(std::ostream& out, bool indent = true) const;
+        //! Serialize the JSON tree whose root is this node to the
+        //!   given buffer (see above).
+        void serialize(Buffer& out, bool indent = true) const;
+        //! Serialize with the given format (see Format).
+        void serialize(std::ostream& out, Format format) const;
+        void serialize(Buffer& out, Format format) const;
+        //! Tell if this node spans multiple lines when indented.
+        bool multiline() const;
+        //! Get the generation of the tree whose root is this node.
+        //! Once a tree is tracked (see track()), the generation of its
+        //!   containers is incremented, along with the ones of their
+        //!   parents, whenever they are accessed through a non-const
+        //!   accessor (which may add, remove or replace nodes, even when
+        //!   the caller only reads), so that
+        //!   data derived from a tree (such as an Index or cached hashes)
+        //!   can detect changes. Scalars and untracked containers stay at
+        //!   generation 0, and changes made to other trees do not count.
+        unsigned long generation() const;
+        //! Track the changes made to the tree whose root is this node
+        //!   (see generation()).
+        //! Containers added to a tracked tree are tracked when the tree
+        //!   is tracked again, and shared subtrees (see share()) report
+        //!   their changes to every tracked tree they belong to.
+        void track() const;
+        //! Structural hash of the tree whose root is this node.
+        //! Equal trees (see equal()) have the same hash, and packed arrays
+        //!   hash like their unpacked counterparts. The hashes of
+        //!   containers are cached (which tracks them), and computed
+        //!   again for the containers whose generation changed only, that
+        //!   is along the path from a change to the root. Concurrent
+        //!   readers may hash the same tree.
+        uint64_t hash() const;
+        //! Deep copy of the tree whose root is this node.
+        //! The copy is made iteratively (so that deep trees do not
+        //!   overflow the stack), packed arrays being copied as a whole.
+        //!   Shared subtrees are copied as well, so the copy does not
+        //!   share anything with this tree.
+        Node* clone() const;
+        
+        //! Share this node, so that it can be added to another container
+        //!   (or kept aside) while staying in its current one.
+        //! Shared nodes are deleted when their last owner releases them,
+        //!   containers releasing their children when deleted. Shared nodes
+        //!   must be released rather than deleted, and changing them
+        //!   changes them for every owner.
+        Node* share();
+        //! Release a node (that is deleted if it has no other owner).
+        static void release(Node* node);
+        //! Get the number of owners of this node.
+        unsigned int owners() const;
         
+        //! Get this node as a T, or 0 if it is not one.
+        //! Reading through the const overload keeps the generation of
+        //!   the tree (see generation()), so lookups should use it.
         template <typename T>
         T* downcast()
         { return M_downcast((T*) 0); }
         
+        template <typename T>
+        T const* downcast() const
+        { return const_cast<Node*>(this)->M_downcast((T*) 0); }
+        
     protected:
-        virtual void M_serialize(std::ostream& out, int level, bool indent) const = 0;
+        //! Change tracking of a container (see track()).
+        struct Link;
+        
+        //! Get the link slot of a container, or 0 for scalars.
+        virtual std::atomic<Link*>* M_slot() const;
+        //! Get the link of a container, creating it if needed.
+        static Link* M_link(Node const* node);
+        //! Make a container report its changes to the given parent.
+        static void M_adopt(Link* parent, Node const* child);
+        static void M_release(Link* link);
+        static bool M_differ(Node const* a, Node const* b);
+        
+        //! Increment the generations of a tracked container
+        //!   and of its parents.
+        static void M_touch(std::atomic<Link*> const& slot)
+        {
+            if (Link* link = slot.load(std::memory_order_relaxed))
+                M_propagate(link);
+        }
+        
+        static void M_propagate(Link* link);
+        virtual void M_serialize(Writer& out) const = 0;
         virtual bool M_multiline() const = 0;
+        virtual uint64_t M_hash() const = 0;
         
         template <typename T>
         T* M_downcast(T*)
@@ -91,28 +180,54 @@ namespace lconf { namespace json
         ArrayNode* M_downcast(ArrayNode*)
         { return M_safeCast<Array, ArrayNode>(); }
         
+        NullNode* M_downcast(NullNode*)
+        { return M_safeCast<Null, NullNode>(); }
+        
         template <Type tp, typename T>
         T* M_safeCast()
         {
             if (type() != tp) return 0;
             return (T*) this;
         }
+        
+    private:
+        Node(Node const&);
+        Node& operator=(Node const&);
+        
+        static Node* M_shallowClone(Node const* node);
+        
+    private:
+        std::atomic<unsigned int> m_owners;
     };
     
     class NumberNode : public Node
     {
     public:
+        //! Numbers are stored as doubles. Values coming from floats are
+        //!   flagged as single precision, so that they are serialized
+        //!   with just enough digits to be read back as the same float.
+        NumberNode(double value, bool single = false);
         NumberNode(float value);
+        NumberNode(int value);
+        NumberNode(unsigned int value);
+        NumberNode(long value);
+        NumberNode(unsigned long value);
+        NumberNode(long long value);
+        NumberNode(unsigned long long value);
         
         Type type() const;
-        float value() const;
+        double value() const;
+        bool isSingle() const;
         
     private:
-        void M_serialize(std::ostream& out, int level, bool indent) const;
+        void M_serialize(Writer& out) const;
         bool M_multiline() const;
+        uint64_t M_hash() const;
         
     private:
-        float m_value;
+        //! Declared first, to fit in the padding after Node::m_owners.
+        bool m_single;
+        double m_value;
     };
     
     class BooleanNode : public Node
@@ -124,8 +239,9 @@ namespace lconf { namespace json
         bool value() const;
         
     private:
-        void M_serialize(std::ostream& out, int level, bool indent) const;
+        void M_serialize(Writer& out) const;
         bool M_multiline() const;
+        uint64_t M_hash() const;
         
     private:
         bool m_value;
@@ -141,54 +257,124 @@ namespace lconf { namespace json
         std::string escapedValue() const;
         
     private:
-        void M_serialize(std::ostream& out, int level, bool indent) const;
+        void M_serialize(Writer& out) const;
         bool M_multiline() const;
+        uint64_t M_hash() const;
         
     private:
         std::string m_value;
     };
     
+    class NullNode : public Node
+    {
+    public:
+        NullNode();
+        
+        Type type() const;
+        
+    private:
+        void M_serialize(Writer& out) const;
+        bool M_multiline() const;
+        uint64_t M_hash() const;
+    };
+    
     class ObjectNode : public Node
     {
+        friend bool equal(Node const* a, Node const* b);
     public:
         ObjectNode();
         ~ObjectNode();
         
         Type type() const;
-        bool exists(std::string const& key);
+        bool exists(std::string const& key) const;
         Node*& get(std::string const& key);
         Node* get(std::string const& key) const;
         std::map<std::string, Node*>& impl();
         std::map<std::string, Node*> const& impl() const;
         
     private:
-        void M_serialize(std::ostream& out, int level, bool indent) const;
+        std::atomic<Link*>* M_slot() const;
+        void M_serialize(Writer& out) const;
         bool M_multiline() const;
+        uint64_t M_hash() const;
         
     private:
         std::map<std::string, Node*> m_impl;
+        mutable std::atomic<Link*> m_link;
     };
     
     class ArrayNode : public Node
     {
+        friend bool equal(Node const* a, Node const* b);
+    public:
+        //! Storage of the array elements.
+        //! Generic arrays own one node per element, while homogeneous
+        //!   arrays of numbers or booleans are packed into a contiguous
+        //!   vector of values.
+        //! Packed arrays are unpacked when their elements are accessed
+        //!   through the non-const at() or impl(), while the const at()
+        //!   leaves them packed.
+        enum Storage
+        {
+            Generic,
+            Numbers,
+            Booleans
+        };
+        
     public:
         ArrayNode();
+        explicit ArrayNode(Storage storage);
         ~ArrayNode();
         
         Type type() const;
+        Storage storage() const;
         size_t size() const;
         Node*& at(size_t i);
+        //! Get the i-th element without changing the array.
+        //! The nodes of packed elements are created on first access and
+        //!   kept aside, so that concurrent readers share them. They stay
+        //!   valid until the array is changed through a non-const
+        //!   accessor, and changing them does not change the array.
         Node* at(size_t i) const;
         std::vector<Node*>& impl();
+        //! Throws std::domain_error for packed arrays (see at() const).
         std::vector<Node*> const& impl() const;
+        std::vector<double>& numbers();
+        std::vector<double> const& numbers() const;
+        //! Flag packed numbers as single precision (see NumberNode).
+        void setSingle(bool single);
+        bool isSingle() const;
+        std::vector<bool>& booleans();
+        std::vector<bool> const& booleans() const;
         
     private:
-        void M_serialize(std::ostream& out, int level, bool indent) const;
+        struct Nodes;
+        
+        void M_unpack();
+        Node* M_node(size_t i) const;
+        void M_dropNodes();
+        std::atomic<Link*>* M_slot() const;
+        void M_serialize(Writer& out) const;
         bool M_multiline() const;
+        uint64_t M_hash() const;
         
     private:
+        Storage m_storage;
         std::vector<Node*> m_impl;
+        std::vector<double> m_numbers;
+        bool m_single;
+        std::vector<bool> m_booleans;
+        //! Nodes of the packed elements read through at() const.
+        mutable std::atomic<Nodes*> m_nodes;
+        mutable std::atomic<Link*> m_link;
     };
+    
+    //! Deep equality of the trees whose roots are a and b.
+    //! Numbers are compared by value (regardless of their precision),
+    //!   and packed arrays are equal to their unpacked counterparts.
+    //!   Containers whose hashes are cached (see Node::hash()) are
+    //!   told apart without comparing their contents.
+    bool equal(Node const* a, Node const* b);
 } }
 
 #endif // LCONF_JSON_NODE_H
@@ -0,0 +1,41 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_NUMBER_H
+#define LCONF_JSON_NUMBER_H
+
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Size of a buffer large enough for any formatNumber() output.
+    enum { NumberLength = 32 };
+
+    //! Write value to out, returning the number of characters written.
+    //! Integral values are written as integers, and other values with
+    //!   a representation that parses back to the same double (or to
+    //!   the same float if single is set), using the Grisu2 algorithm
+    //!   (which yields the shortest one for all but a tiny fraction
+    //!   of values).
+    //! The output is locale-independent.
+    //! Throws a std::domain_error if value is infinite or NaN, as
+    //!   JSON has no representation for them.
+    std::size_t formatNumber(double value, char* out, bool single = false);
+} }
+
+#endif // LCONF_JSON_NUMBER_H
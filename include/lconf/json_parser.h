@@ -21,6 +21,11 @@
 
 #include "lconf/json_lexer.h"
 #include "lconf/json_node.h"
+#include "lconf/json_status.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
 
 namespace lconf { namespace json
 {
@@ -30,17 +35,57 @@ namespace lconf { namespace json
         Parser(Lexer& lex);
         ~Parser();
         
+        //! Throws a std::logic_error on syntax errors.
         Node* parse();
+        //! Parse without throwing : returns 0 on failure, with the
+        //!   error described by status, which is reset otherwise.
+        Node* parse(Status& status);
+        //! Recovery mode, for bulk validation : syntax errors are
+        //!   appended to errors (in document order), and parsing goes
+        //!   on after each of them, from the next `,' or the end of the
+        //!   enclosing object or array. Tokens following the root value
+        //!   are reported as well.
+        //! Returns the tree of what could be parsed (the values in
+        //!   error being left out), or 0 if there is none.
+        Node* parse(std::vector<Status>& errors);
+        //! Get the position of a value parsed in recovery mode (for
+        //!   the diagnostics of later stages), returning false if node
+        //!   does not come from the parsed text.
+        bool position(Node const* node, std::size_t& line, std::size_t& column) const;
+        //! Get the paths of the files included while parsing,
+        //!   nested includes included, in order of appearance.
+        std::vector<std::string> const& includes() const;
         
     private:
+        Node* M_root();
         Node* M_atom();
+        Node* M_value();
         Node* M_object();
+        bool M_entry(ObjectNode* node);
         Node* M_array();
         
-        void M_error(Token const& at, std::string const& msg);
+        //! Record a syntax error, delete the partially built node,
+        //!   and return 0.
+        Node* M_error(Token const& at, std::string const& msg, Node* partial = 0);
+        //! Keep the error of m_status, in recovery mode.
+        void M_record();
+        //! Skip the tokens following an error in recovery mode, up to
+        //!   the next `,' of the current object or array (eaten), or its
+        //!   end. Returns false if there is no such `,'.
+        bool M_resync();
+        //! Number of errors recorded in recovery mode, and prefixing
+        //!   of the paths of the errors met inside a value.
+        std::size_t M_errors() const;
+        void M_prefix(std::size_t first, std::string const& key);
+        void M_prefix(std::size_t first, std::size_t index);
         
     private:
         Lexer& m_lex;
+        Status* m_status;
+        std::vector<Status>* m_errors;
+        //! Offsets of the values parsed in recovery mode.
+        std::unordered_map<Node const*, std::size_t> m_offsets;
+        std::vector<std::string> m_includes;
     };
 } }
 
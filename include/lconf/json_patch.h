@@ -0,0 +1,59 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_PATCH_H
+#define LCONF_JSON_PATCH_H
+
+#include "lconf/json_node.h"
+
+namespace lconf { namespace json
+{
+    //! Compute the RFC 6902 patch turning from into to.
+    //! The patch is an array of "add", "remove" and "replace" operations,
+    //!   only covering what changed : objects are compared key by key and
+    //!   arrays element by element (trailing elements being added or
+    //!   removed), and equal subtrees yield no operation (hashes, see
+    //!   Node::hash(), telling most different subtrees apart at once).
+    //! Returns a new tree (to be deleted by the caller).
+    Node* diff(Node const* from, Node const* to);
+
+    //! Apply an RFC 6902 patch (any of the "add", "remove", "replace",
+    //!   "move", "copy" and "test" operations) to the tree whose root is
+    //!   node, in place.
+    //! Returns the root of the patched tree, which differs from node if
+    //!   the whole document is replaced (node is then released, once all
+    //!   the operations succeeded).
+    //! Throws a json::Exception on the first operation that fails, node
+    //!   still belonging to the caller. The operations preceding it are
+    //!   not rolled back (besides the replacements of the whole
+    //!   document), so patch a copy of the tree if it must be left
+    //!   untouched on failure. A failing "move" leaves the moved value
+    //!   in place.
+    Node* patch(Node* node, Node const* ops);
+
+    //! Compute the RFC 7396 merge patch turning from into to.
+    //! Removed keys are set to null, and arrays are replaced as a whole
+    //!   (null values of to can not be represented in a merge patch).
+    Node* mergeDiff(Node const* from, Node const* to);
+
+    //! Apply an RFC 7396 merge patch to the tree whose root is node,
+    //!   in place (see patch() for the returned root).
+    Node* mergePatch(Node* node, Node const* patch);
+} }
+
+#endif // LCONF_JSON_PATCH_H
@@ -0,0 +1,108 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_PATH_H
+#define LCONF_JSON_PATH_H
+
+#include "lconf/json_node.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Compiled path expression.
+    //! Paths are RFC 6901 JSON pointers, such as "/servers/0/name"
+    //!   ("" being the whole document, and "~0" and "~1" standing for
+    //!   '~' and '/' in keys). Extended paths also accept the following
+    //!   segments :
+    //!   - "*" matches every element of an array or object,
+    //!   - "**" matches a value and all of its descendants,
+    //!   - "?key=literal" matches the elements of an array or object
+    //!     that are objects whose entry key equals the literal (true,
+    //!     false, null, a number, or a string, optionally double quoted).
+    //! A path is parsed once, and can then be evaluated against any
+    //!   number of trees.
+    class Path
+    {
+    public:
+        Path();
+        //! Compile the given expression.
+        //! Throws a std::logic_error if it is malformed.
+        explicit Path(std::string const& expr, bool extended = true);
+
+        //! Get the first matching node (in document order), or 0.
+        Node* find(Node* root) const;
+        //! Append all the matching nodes to out, in document order.
+        void select(Node* root, std::vector<Node*>& out) const;
+        std::vector<Node*> select(Node* root) const;
+
+        //! Tell if the path is a plain pointer, matching at most one node.
+        bool isPointer() const;
+        std::string const& str() const;
+
+        //! Segments of plain pointers : unescaped key, and array
+        //!   index if the key is one.
+        std::size_t size() const;
+        std::string const& key(std::size_t i) const;
+        bool isIndex(std::size_t i) const;
+        std::size_t index(std::size_t i) const;
+
+        //! Escape a key as a pointer segment ("~" and "/" become
+        //!   "~0" and "~1").
+        static std::string escape(std::string const& key);
+
+    private:
+        struct Step
+        {
+            enum Kind
+            {
+                Key,
+                Wildcard,
+                Descendants,
+                Filter
+            };
+
+            Kind kind;
+            //! Object key, or filtered key.
+            std::string key;
+            //! Array index, if key is one.
+            bool isIndex;
+            std::size_t index;
+            //! Filter literal.
+            Node::Type type;
+            std::string string;
+            double number;
+            bool boolean;
+        };
+
+    private:
+        void M_compile(std::string const& segment, bool extended);
+        bool M_select(Node* node, std::size_t step, std::vector<Node*>& out, bool first) const;
+        bool M_children(Node* node, std::size_t step, std::vector<Node*>& out, bool first) const;
+        bool M_descendants(Node* node, std::size_t step, std::vector<Node*>& out, bool first) const;
+        bool M_matches(Node* node, Step const& filter) const;
+
+    private:
+        std::string m_expr;
+        std::vector<Step> m_steps;
+        bool m_pointer;
+    };
+} }
+
+#endif // LCONF_JSON_PATH_H
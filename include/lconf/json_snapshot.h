@@ -0,0 +1,160 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_SNAPSHOT_H
+#define LCONF_JSON_SNAPSHOT_H
+
+#include "lconf/json_node.h"
+#include "lconf/json_file.h"
+#include <string>
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+
+namespace lconf { namespace json
+{
+    //! Fixed-size value slot of a snapshot.
+    //! Scalars are stored inline, and strings and containers hold
+    //!   the offset of their contents from the start of the snapshot,
+    //!   so that a snapshot can be mapped at any address.
+    struct Slot
+    {
+        enum Kind
+        {
+            Number,
+            Boolean,
+            String,
+            Object,
+            Array,
+            //! Packed arrays (see ArrayNode), pointing to
+            //!   contiguous doubles or bytes.
+            Numbers,
+            Booleans,
+            Null
+        };
+
+        uint8_t kind;
+        //! Single precision flag (see NumberNode).
+        uint8_t single;
+        uint16_t reserved;
+        //! String length or number of elements.
+        uint32_t count;
+        //! Number value, boolean value or contents offset.
+        union
+        {
+            double number;
+            uint64_t offset;
+        };
+    };
+
+    //! Read-only view of a value stored in a snapshot.
+    //! Views are small values that can be freely copied, and are valid
+    //!   as long as the snapshot they come from.
+    //! Snapshots are not trusted : corrupted offsets throw a
+    //!   std::logic_error, and so do values nested more than 1024
+    //!   levels deep.
+    class View
+    {
+    public:
+        View();
+        View(char const* base, std::size_t size, Slot const& slot);
+
+        Node::Type type() const;
+        double number() const;
+        bool isSingle() const;
+        bool boolean() const;
+        //! Get the contents of a string (null terminated).
+        char const* string() const;
+        //! Get the length of a string, or the number of elements
+        //!   of an object or array.
+        std::size_t size() const;
+
+        //! Object entries, sorted by key.
+        std::string key(std::size_t i) const;
+        bool exists(std::string const& key) const;
+        //! Find the value associated with key (by binary search).
+        //! Returns false if there is no such entry.
+        bool find(std::string const& key, View& value) const;
+        View get(std::string const& key) const;
+
+        //! Get the i-th element of an array, or the i-th
+        //!   entry value of an object.
+        View at(std::size_t i) const;
+        //! Get the contents of packed arrays, or null pointers
+        //!   for other values.
+        double const* numbers() const;
+        uint8_t const* booleans() const;
+
+        //! Build a JSON tree from the viewed value.
+        Node* materialize() const;
+
+    private:
+        View M_child(Slot const& slot) const;
+        template <typename T>
+        T const* M_data(std::size_t count) const;
+
+    private:
+        char const* m_base;
+        std::size_t m_size;
+        Slot m_slot;
+        //! Nesting level, from the root of the snapshot.
+        unsigned int m_depth;
+    };
+
+    //! Memory-mappable snapshot of a JSON tree.
+    //! Snapshots are queried in place through View objects, without any
+    //!   deserialization. Mapped snapshots are shared read-only, so
+    //!   processes loading the same file share the same physical pages.
+    //! The format uses the host byte order, and snapshots from hosts
+    //!   of different endianness are rejected.
+    class Snapshot
+    {
+    public:
+        //! Map the given snapshot file.
+        explicit Snapshot(std::string const& file);
+        //! Use size bytes at data, which must be 8 bytes aligned and
+        //!   outlive the snapshot (the data is not copied).
+        Snapshot(void const* data, std::size_t size);
+        ~Snapshot();
+
+        View root() const;
+        char const* data() const;
+        std::size_t size() const;
+
+        //! Write the snapshot of the tree whose root is node.
+        //! Throws a std::logic_error if values are nested more than
+        //!   1024 levels deep (see View).
+        static void write(Node const* node, std::ostream& out);
+        //! flags is a combination of WriteFlags (snapshots are replaced
+        //!   atomically by default, as they may be mapped by readers).
+        static void write(Node const* node, std::string const& file, int flags = Atomic);
+
+    private:
+        Snapshot(Snapshot const&);
+        Snapshot& operator=(Snapshot const&);
+
+        void M_check();
+
+    private:
+        char const* m_data;
+        std::size_t m_size;
+        bool m_mapped;
+    };
+} }
+
+#endif // LCONF_JSON_SNAPSHOT_H
@@ -0,0 +1,95 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_STATUS_H
+#define LCONF_JSON_STATUS_H
+
+#include "lconf/json_node.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Outcome of the non-throwing entry points (see tryParse() and
+    //!   Template::extract()), describing the first error met.
+    //! Failures cost no exception, so that batches of untrusted
+    //!   documents can be validated cheaply.
+    struct Status
+    {
+        enum Code
+        {
+            Ok,
+            //! A file could not be opened.
+            IoError,
+            //! Malformed JSON text.
+            SyntaxError,
+            //! Type mismatch, missing element or too short array.
+            TypeError,
+            //! Badly encoded or sized POD or raw buffer.
+            ValueError,
+            //! Extraction to a const or unbound template, or to
+            //!   already allocated raw memory.
+            BindingError,
+            //! Exception thrown by a user element.
+            UserError
+        };
+
+        Status();
+
+        bool ok() const;
+        //! Reset to Ok.
+        void clear();
+
+        //! Record a failure, and return false so that it can end
+        //!   a failing call.
+        bool fail(Code code, std::string const& message, Node* node = 0);
+        //! Record a syntax error at the given position.
+        bool fail(std::size_t line, std::size_t column, std::string const& message);
+        //! Prepend a key or an index to path, while unwinding
+        //!   from the offending value.
+        void prefix(std::string const& key);
+        void prefix(std::size_t index);
+
+        //! Throw the exception the throwing entry points would have
+        //!   thrown : a json::Exception for extraction errors, and a
+        //!   std::logic_error otherwise.
+        void raise() const;
+
+        Code code;
+        //! Full error message, as the exception's what().
+        std::string message;
+        //! Position of syntax errors (starting at 1), or of the offending
+        //!   value for json::validate(), 0 otherwise.
+        std::size_t line;
+        std::size_t column;
+        //! JSON pointer of the offending value (or of the missing
+        //!   one), relative to the parsed or extracted root.
+        std::string path;
+        //! Offending node, for extraction errors on a tree that is
+        //!   still alive (0 otherwise).
+        Node* node;
+    };
+
+    //! Prepend a key or an index to the paths of the errors
+    //!   recorded from first on (see Status::prefix()).
+    void prefix(std::vector<Status>& errors, std::size_t first, std::string const& key);
+    void prefix(std::vector<Status>& errors, std::size_t first, std::size_t index);
+} }
+
+#endif // LCONF_JSON_STATUS_H
@@ -0,0 +1,367 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_STRUCT_H
+#define LCONF_JSON_STRUCT_H
+
+#include "lconf/json_template.h"
+#include <type_traits>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace lconf { namespace json
+{
+    //! Compile-time field list of a structure.
+    //! It is specialized by the LCONF_JSON_STRUCT() macro below, and
+    //!   must provide a static visit(visitor, ref) function calling
+    //!   visitor(name, member) once for each field of ref.
+    template <typename T>
+    struct Fields;
+
+    //! Generic structure element.
+    //! Each field is handled by a Terminal<> instance living on the stack,
+    //!   so no Template graph is ever allocated, and the field accesses
+    //!   are resolved at compile time (the structure itself is still
+    //!   reached through the virtual Element interface).
+    template <typename T>
+    class Struct : public Element
+    {
+    public:
+        Struct(T& ref) :
+            m_ref(ref),
+            m_is_const(false)
+        {}
+
+        Struct(T const& ref) :
+            m_ref(const_cast<T&>(ref)),
+            m_is_const(true)
+        {}
+
+        Type type() const
+        { return Element::Object; }
+
+        void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
+        {
+            if (m_is_const)
+                return status.fail(Status::BindingError, "json::Struct[const]::extract: extracting to const binding", node);
+
+            if (node->type() != Node::Object)
+                return status.fail(Status::TypeError, "json::Struct::extract: type mismatch", node);
+
+            Extractor extractor(node, status);
+            Fields<T>::visit(extractor, m_ref);
+            return extractor.ok;
+        }
+
+        bool extract(Node* node, std::vector<Status>& errors) const
+        {
+            if (m_is_const || node->type() != Node::Object)
+                return Element::extract(node, errors);
+
+            std::size_t first = errors.size();
+            CollectingExtractor extractor(node, errors);
+            Fields<T>::visit(extractor, m_ref);
+            return errors.size() == first;
+        }
+
+        void extract(View const& view) const
+        {
+            if (m_is_const)
+                throw Exception(0, "json::Struct[const]::extract: extracting to const binding");
+
+            if (view.type() != Node::Object)
+                throw Exception(0, "json::Struct::extract: type mismatch");
+
+            ViewExtractor extractor(view);
+            Fields<T>::visit(extractor, m_ref);
+        }
+
+        Node* synthetize() const
+        {
+            Synthetizer synthetizer;
+            try
+            {
+                Fields<T>::visit(synthetizer, m_ref);
+            }
+            catch (...)
+            {
+                delete synthetizer.obj;
+                throw;
+            }
+            return synthetizer.obj;
+        }
+
+        bool isConst() const
+        { return m_is_const; }
+
+        //! Fields are written in key order, as in the synthetized tree.
+        void write(Writer& out) const
+        {
+            std::vector<Field> const& fields = M_fields();
+            out.beginObject();
+            for (std::size_t i = 0; i < fields.size(); ++i)
+            {
+                out.key(fields[i].name);
+                fields[i].write(out, M_member(fields[i]));
+            }
+            out.endObject();
+        }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        {
+            std::vector<Field> const& fields = M_fields();
+            if (fragment.children.size() < fields.size())
+                fragment.children.resize(fields.size());
+
+            out.beginObject();
+            for (std::size_t i = 0; i < fields.size(); ++i)
+            {
+                out.key(fields[i].name);
+                fields[i].writeFragment(out, M_member(fields[i]), fragment.children[fields[i].index], previous);
+            }
+            out.endObject();
+        }
+
+        bool multiline() const
+        { return true; }
+
+    private:
+        //! Field visitor used by extract(), skipping the
+        //!   remaining fields after a failure.
+        struct Extractor
+        {
+            Extractor(Node* node, Status& status) :
+                node(node),
+                obj(node->downcast<ObjectNode>()),
+                status(status),
+                ok(true)
+            {}
+
+            template <typename F>
+            void operator()(char const* name, F& field)
+            {
+                if (!ok)
+                    return;
+
+                if (!obj->exists(name))
+                    ok = status.fail(Status::TypeError, std::string("json::Struct::extract: missing element `") + name + "'", node);
+                else
+                {
+                    Terminal<typename std::remove_const<F>::type> term(field);
+                    ok = static_cast<Element const&>(term).extract(obj->get(name), status);
+                }
+
+                if (!ok)
+                    status.prefix(name);
+            }
+
+            Node* node;
+            ObjectNode const* obj;
+            Status& status;
+            bool ok;
+        };
+
+        //! Field visitor used by the error collecting extract().
+        struct CollectingExtractor
+        {
+            CollectingExtractor(Node* node, std::vector<Status>& errors) :
+                node(node),
+                obj(node->downcast<ObjectNode>()),
+                errors(errors)
+            {}
+
+            template <typename F>
+            void operator()(char const* name, F& field)
+            {
+                std::size_t mark = errors.size();
+                if (!obj->exists(name))
+                {
+                    errors.push_back(Status());
+                    errors.back().fail(Status::TypeError, std::string("json::Struct::extract: missing element `") + name + "'", node);
+                }
+                else
+                {
+                    Terminal<typename std::remove_const<F>::type> term(field);
+                    static_cast<Element const&>(term).extract(obj->get(name), errors);
+                }
+                prefix(errors, mark, name);
+            }
+
+            Node* node;
+            ObjectNode const* obj;
+            std::vector<Status>& errors;
+        };
+
+        //! Field visitor used by extract(View const&).
+        struct ViewExtractor
+        {
+            ViewExtractor(View const& view) :
+                view(view)
+            {}
+
+            template <typename F>
+            void operator()(char const* name, F& field)
+            {
+                View value;
+                if (!view.find(name, value))
+                    throw Exception(0, std::string("json::Struct::extract: missing element `") + name + "'");
+
+                Terminal<typename std::remove_const<F>::type> term(field);
+                static_cast<Element const&>(term).extract(value);
+            }
+
+            View const& view;
+        };
+
+        //! Field visitor used by synthetize().
+        struct Synthetizer
+        {
+            Synthetizer() :
+                obj(new ObjectNode())
+            {}
+
+            template <typename F>
+            void operator()(char const* name, F& field)
+            {
+                Terminal<typename std::remove_const<F>::type> term(field);
+                obj->impl()[name] = term.synthetize();
+            }
+
+            ObjectNode* obj;
+        };
+
+        //! Writing entry of a field : its offset in the structure, and
+        //!   the writing functions of its type.
+        struct Field
+        {
+            char const* name;
+            //! Declaration index, numbering the incremental fragments.
+            std::size_t index;
+            std::size_t offset;
+            void (*write)(Writer& out, void* member);
+            void (*writeFragment)(Writer& out, void* member, Fragment& fragment, std::string const& previous);
+
+            bool operator<(Field const& other) const
+            { return std::strcmp(name, other.name) < 0; }
+        };
+
+        template <typename F>
+        static void M_writeField(Writer& out, void* member)
+        {
+            Terminal<typename std::remove_const<F>::type> term(*static_cast<F*>(member));
+            term.write(out);
+        }
+
+        template <typename F>
+        static void M_writeFragment(Writer& out, void* member, Fragment& fragment, std::string const& previous)
+        {
+            Terminal<typename std::remove_const<F>::type> term(*static_cast<F*>(member));
+            static_cast<Element const&>(term).write(out, fragment, previous);
+        }
+
+        //! Field visitor building the writing entries.
+        struct Collector
+        {
+            Collector(T& ref) :
+                base(reinterpret_cast<char*>(&ref))
+            {}
+
+            template <typename F>
+            void operator()(char const* name, F& field)
+            {
+                Field entry;
+                entry.name = name;
+                entry.index = fields.size();
+                entry.offset = reinterpret_cast<char*>(const_cast<typename std::remove_const<F>::type*>(&field)) - base;
+                entry.write = &M_writeField<F>;
+                entry.writeFragment = &M_writeFragment<F>;
+                fields.push_back(entry);
+            }
+
+            char* base;
+            std::vector<Field> fields;
+        };
+
+        //! Writing entries of the fields, sorted by name.
+        //! They only depend on T, and are built once.
+        std::vector<Field> const& M_fields() const
+        {
+            static std::vector<Field> const fields = M_collectFields();
+            return fields;
+        }
+
+        std::vector<Field> M_collectFields() const
+        {
+            Collector collector(m_ref);
+            Fields<T>::visit(collector, m_ref);
+            std::sort(collector.fields.begin(), collector.fields.end());
+            return collector.fields;
+        }
+
+        void* M_member(Field const& field) const
+        { return reinterpret_cast<char*>(&m_ref) + field.offset; }
+
+    private:
+        T& m_ref;
+        bool m_is_const;
+    };
+} }
+
+//! Declare a field in a LCONF_JSON_STRUCT() field list.
+#define LCONF_JSON_FIELD(name) \
+    visitor(#name, ref.name);
+
+//! Expose a structure to the json::Template system.
+//! This must be used from the global namespace, with a fully
+//!   qualified type name, for example :
+//!
+//!   LCONF_JSON_STRUCT(app::Point,
+//!       LCONF_JSON_FIELD(x)
+//!       LCONF_JSON_FIELD(y))
+//!
+//! The structure is then bound, extracted and synthetized as a JSON
+//!   object with one entry per field, nested structures and STL
+//!   containers of structures included.
+#define LCONF_JSON_STRUCT(T, fields) \
+    namespace lconf { namespace json \
+    { \
+        template <> \
+        struct Fields<T> \
+        { \
+            template <typename V, typename R> \
+            static void visit(V& visitor, R& ref) \
+            { fields } \
+        }; \
+        \
+        template <> \
+        class Terminal<T> : public Struct<T> \
+        { \
+        public: \
+            Terminal(T& ref) : Struct<T>(ref) \
+            {} \
+            \
+            Terminal(T const& ref) : Struct<T>(ref) \
+            {} \
+        }; \
+    } }
+
+#endif // LCONF_JSON_STRUCT_H
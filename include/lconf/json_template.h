@@ -20,12 +20,16 @@
 #define LCONF_JSON_TEMPLATE_H
 
 #include "lconf/json_node.h"
+#include "lconf/json_writer.h"
+#include "lconf/json_codec.h"
+#include "lconf/json_snapshot.h"
+#include "lconf/json_status.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <sstream>
-#include <iomanip>
 #include <cstdint>
+#include <type_traits>
 
 namespace lconf { namespace json
 {
@@ -40,6 +44,40 @@ namespace lconf { namespace json
         Node* m_node;
     };
     
+    //! Where a bound element was written by the previous incremental
+    //!   write (see Incremental), and a copy of the data it was written
+    //!   from (for leaves) or the fragments of its children.
+    struct Fragment
+    {
+        Fragment() :
+            valid(false),
+            begin(0),
+            end(0)
+        {}
+
+        bool valid;
+        std::string shadow;
+        std::size_t begin;
+        std::size_t end;
+        std::vector<Fragment> children;
+    };
+
+    //! Raw representation of bound values, compared to the shadow
+    //!   of their fragment to detect changes.
+    template <typename T>
+    inline void const* shadowData(T const& value)
+    { return &value; }
+
+    template <typename T>
+    inline std::size_t shadowSize(T const&)
+    { return sizeof(T); }
+
+    inline void const* shadowData(std::string const& value)
+    { return value.data(); }
+
+    inline std::size_t shadowSize(std::string const& value)
+    { return value.size(); }
+
     //! Common abstract template element interface.
     class Element
     {
@@ -61,8 +99,43 @@ namespace lconf { namespace json
         virtual ~Element();
         virtual Type type() const = 0;
         virtual void extract(Node* node) const = 0;
+        //! Extract without throwing : returns false on failure, with the
+        //!   error described by status (its path being relative to node).
+        //! The default implementation catches the exceptions of extract().
+        virtual bool extract(Node* node, Status& status) const;
+        //! Extract as much as possible, appending every error to errors
+        //!   (see Template::extract()), and return false if there is any.
+        //! The default implementation reports the first error only, which
+        //!   suits leaves.
+        virtual bool extract(Node* node, std::vector<Status>& errors) const;
+        //! Extract from a snapshot, in place.
+        //! The default implementation extracts from the materialized tree.
+        virtual void extract(View const& view) const;
         virtual Node* synthetize() const = 0;
         virtual bool isConst() const = 0;
+        //! Write the bound data to a streaming writer, without
+        //!   building a JSON tree.
+        //! The default implementation writes the synthetized tree.
+        virtual void write(Writer& out) const;
+        //! Tell if the bound data spans multiple lines when indented
+        //!   (see Node::multiline()).
+        //! The default implementation answers from type() for objects
+        //!   and scalars, and synthetizes the data otherwise : user
+        //!   elements bound in arrays should override it.
+        virtual bool multiline() const;
+        //! Incremental write (see Incremental), splicing the output of the
+        //!   previous write, from previous, if the data did not change.
+        //! The default implementation always writes the data.
+        virtual void write(Writer& out, Fragment& fragment, std::string const& previous) const;
+        
+    protected:
+        //! Throwing extraction on top of extract(node, status), for the
+        //!   elements implementing the latter.
+        void M_extractOrThrow(Node* node) const;
+        //! Incremental write of a single-line leaf, whose data is
+        //!   represented by size bytes (see shadowData()).
+        void M_write(Writer& out, Fragment& fragment, std::string const& previous,
+                     void const* data, std::size_t size) const;
         
     public:
         int refs;
@@ -92,6 +165,16 @@ namespace lconf { namespace json
         { return false; }
     };
     
+    //! Read a scalar of a snapshot, as held by the node class N.
+    inline double viewValue(View const& view, NumberNode*)
+    { return view.number(); }
+
+    inline bool viewValue(View const& view, BooleanNode*)
+    { return view.boolean(); }
+
+    inline std::string viewValue(View const& view, StringNode*)
+    { return std::string(view.string(), view.size()); }
+
     //! Generic scalar element.
     template <Node::Type tp, typename N, typename T>
     class Scalar : public Element
@@ -111,13 +194,27 @@ namespace lconf { namespace json
         { return Element::Scalar; }
         
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::Scalar[const]::extract extracting to const binding");
+                return status.fail(Status::BindingError, "json::Scalar[const]::extract extracting to const binding", node);
 
             if (node->type() != tp)
-                throw Exception(node, "json::Scalar::extract: expecting a node of type " + Node::typeName(tp));
+                return status.fail(Status::TypeError, "json::Scalar::extract: expecting a node of type " + Node::typeName(tp), node);
             m_ref = node->downcast<N>()->value();
+            return true;
+        }
+
+        void extract(View const& view) const
+        {
+            if (m_is_const)
+                throw Exception(0, "json::Scalar[const]::extract extracting to const binding");
+
+            if (view.type() != tp)
+                throw Exception(0, "json::Scalar::extract: expecting a node of type " + Node::typeName(tp));
+            m_ref = viewValue(view, (N*) 0);
         }
         
         Node* synthetize() const
@@ -125,6 +222,15 @@ namespace lconf { namespace json
 
         bool isConst() const
         { return false; }
+
+        void write(Writer& out) const
+        { out.value(m_ref); }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        { M_write(out, fragment, previous, shadowData(m_ref), shadowSize(m_ref)); }
+
+        bool multiline() const
+        { return false; }
         
     protected:
         T& m_ref;
@@ -136,59 +242,61 @@ namespace lconf { namespace json
     class POD : public Element
     {
     public:
-        POD(T& ref) :
+        POD(T& ref, Encoding encoding = Hex) :
             m_ref(ref),
-            m_is_const(false)
+            m_is_const(false),
+            m_encoding(encoding)
         {}
 
-        POD(T const& ref) :
+        POD(T const& ref, Encoding encoding = Hex) :
             m_ref(const_cast<T&>(ref)),
-            m_is_const(true)
+            m_is_const(true),
+            m_encoding(encoding)
         {}
 
         Type type() const
         { return Element::POD; }
 
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::POD[const]::extract: extracting to const binding");
+                return status.fail(Status::BindingError, "json::POD[const]::extract: extracting to const binding", node);
 
             if (node->type() != Node::String)
-                throw Exception(node, "json::POD::extract: expecting a string node");
+                return status.fail(Status::TypeError, "json::POD::extract: expecting a string node", node);
 
-            std::string as_hex = node->downcast<json::StringNode>()->value();
-            if (as_hex.size() % 2 != 0 || as_hex.size() / 2 != sizeof(T))
-                throw Exception(node, "json::POD::extract: bad buffer size");
+            std::string const& encoded = node->downcast<json::StringNode>()->value();
+            std::size_t size;
+            if (!decodedSize(m_encoding, encoded, size) || size != sizeof(T))
+                return status.fail(Status::ValueError, "json::POD::extract: bad buffer size", node);
 
-            uint8_t* data = reinterpret_cast<uint8_t*>(&m_ref);
-            for (std::size_t byte = 0; byte < as_hex.size()/2; ++byte)
-            {
-                std::istringstream ss(as_hex.substr(2*byte, 2));
-                ss >> std::hex;
-                int value;
-                ss >> value;
-                data[byte] = static_cast<uint8_t>(value & 0xFF);
-            }
+            if (!decode(m_encoding, encoded, &m_ref))
+                return status.fail(Status::ValueError, "json::POD::extract: invalid encoded data", node);
+            return true;
         }
 
         Node* synthetize() const
-        {
-            std::ostringstream ss;
-            uint8_t* data = reinterpret_cast<uint8_t*>(&m_ref);
-
-            for (std::size_t byte = 0; byte < sizeof(T); ++byte)
-                ss << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(data[byte]);
-
-            return new StringNode(ss.str());
-        }
+        { return new StringNode(encode(m_encoding, &m_ref, sizeof(T))); }
 
         bool isConst() const
         { return m_is_const; }
 
+        void write(Writer& out) const
+        { out.value(encode(m_encoding, &m_ref, sizeof(T))); }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        { M_write(out, fragment, previous, &m_ref, sizeof(T)); }
+
+        bool multiline() const
+        { return false; }
+
     private:
         T& m_ref;
         bool m_is_const;
+        Encoding m_encoding;
     };
 
     //! Used to tag types as POD
@@ -196,10 +304,11 @@ namespace lconf { namespace json
     struct tag_as_pod_impl
     {
     public:
-        tag_as_pod_impl(T& ref) : ref(ref)
+        tag_as_pod_impl(T& ref, Encoding encoding) : ref(ref), encoding(encoding)
         {}
 
         T& ref;
+        Encoding encoding;
     };
 
     //! Used to tag types as POD (const)
@@ -207,20 +316,23 @@ namespace lconf { namespace json
     struct tag_as_const_pod_impl
     {
     public:
-        tag_as_const_pod_impl(T const& ref) : ref(ref)
+        tag_as_const_pod_impl(T const& ref, Encoding encoding) : ref(ref), encoding(encoding)
         {}
 
         T const& ref;
+        Encoding encoding;
     };
 
     //! Used to tag types as POD
+    //! The binary contents are stored as a string, using
+    //!   the given encoding.
     template<typename T>
-    static tag_as_pod_impl<T> ref_as_pod(T& ref)
-    { return tag_as_pod_impl<T>(ref); }
+    static tag_as_pod_impl<T> ref_as_pod(T& ref, Encoding encoding = Hex)
+    { return tag_as_pod_impl<T>(ref, encoding); }
 
     template<typename T>
-    static tag_as_const_pod_impl<T> ref_as_pod(T const& ref)
-    { return tag_as_const_pod_impl<T>(ref); }
+    static tag_as_const_pod_impl<T> ref_as_pod(T const& ref, Encoding encoding = Hex)
+    { return tag_as_const_pod_impl<T>(ref, encoding); }
 
 
     //! Generic POD element.
@@ -228,16 +340,18 @@ namespace lconf { namespace json
     class Raw : public Element
     {
     public:
-        Raw(T*& ptr, std::size_t& size) :
+        Raw(T*& ptr, std::size_t& size, Encoding encoding = Hex) :
             m_ptr(&ptr),
             m_size(&size),
-            m_is_const(false)
+            m_is_const(false),
+            m_encoding(encoding)
         {}
 
-        Raw(T const* ptr, std::size_t size) :
+        Raw(T const* ptr, std::size_t size, Encoding encoding = Hex) :
             m_ptr(new T*(const_cast<T*>(ptr))),
             m_size(new std::size_t(size)),
-            m_is_const(true)
+            m_is_const(true),
+            m_encoding(encoding)
         {}
 
         ~Raw()
@@ -253,62 +367,58 @@ namespace lconf { namespace json
         { return Element::Raw; }
 
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::Raw[const]::extract: extracting to const binding");
+                return status.fail(Status::BindingError, "json::Raw[const]::extract: extracting to const binding", node);
 
             if (node->type() != Node::String)
-                throw Exception(node, "json::Raw::extract: expecting a string node");
+                return status.fail(Status::TypeError, "json::Raw::extract: expecting a string node", node);
 
             if (*m_ptr != 0)
-                throw Exception(node, "json::Raw::extract: target memory is already allocated");
+                return status.fail(Status::BindingError, "json::Raw::extract: target memory is already allocated", node);
 
-            std::string as_hex = node->downcast<json::StringNode>()->value();
-            if (as_hex.size() % 2 != 0)
-                throw Exception(node, "json::Raw::extract: bad buffer size");
+            std::string const& encoded = node->downcast<json::StringNode>()->value();
+            std::size_t bytes;
+            if (!decodedSize(m_encoding, encoded, bytes) || bytes % sizeof(T) != 0)
+                return status.fail(Status::ValueError, "json::Raw::extract: bad buffer size", node);
 
-            *m_size = as_hex.size() / (2 * sizeof(T));
-            *m_ptr = new T[*m_size];
+            std::size_t size = bytes / sizeof(T);
+            T* ptr = new T[size];
 
-            for (std::size_t i = 0; i < *m_size; ++i)
+            if (!decode(m_encoding, encoded, ptr))
             {
-                uint8_t* data = reinterpret_cast<uint8_t*>(&(*m_ptr)[i]);
-
-                for (std::size_t byte = 0; byte < sizeof(T); ++byte)
-                {
-                    std::string nibbles = as_hex.substr(2*i * sizeof(T) + 2*byte, 2);
-
-                    std::istringstream ss(nibbles);
-                    ss >> std::hex;
-                    int value;
-                    ss >> value;
-
-                    data[byte] = static_cast<uint8_t>(value & 0xFF);
-                }
+                delete[] ptr;
+                return status.fail(Status::ValueError, "json::Raw::extract: invalid encoded data", node);
             }
+
+            *m_ptr = ptr;
+            *m_size = size;
+            return true;
         }
 
         Node* synthetize() const
-        {
-            std::ostringstream ss;
-
-            for (std::size_t i = 0; i < *m_size; ++i)
-            {
-                uint8_t* data = reinterpret_cast<uint8_t*>(&(*m_ptr)[i]);
-                for (std::size_t byte = 0; byte < sizeof(T); ++byte)
-                    ss << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(data[byte]);
-            }
-
-            return new StringNode(ss.str());
-        }
+        { return new StringNode(encode(m_encoding, *m_ptr, *m_size * sizeof(T))); }
 
         bool isConst() const
         { return m_is_const; }
 
+        void write(Writer& out) const
+        { out.value(encode(m_encoding, *m_ptr, *m_size * sizeof(T))); }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        { M_write(out, fragment, previous, *m_ptr, *m_size * sizeof(T)); }
+
+        bool multiline() const
+        { return false; }
+
     private:
         T** m_ptr;
         std::size_t* m_size;
         bool m_is_const;
+        Encoding m_encoding;
     };
 
     //! Used to tag types as RAW
@@ -316,11 +426,12 @@ namespace lconf { namespace json
     struct tag_as_raw_impl
     {
     public:
-        tag_as_raw_impl(T*& ptr, std::size_t& size) : ptr(ptr), size(size)
+        tag_as_raw_impl(T*& ptr, std::size_t& size, Encoding encoding) : ptr(ptr), size(size), encoding(encoding)
         {}
 
         T*& ptr;
         std::size_t& size;
+        Encoding encoding;
     };
 
     //! Used to tag types as RAW (const)
@@ -328,22 +439,39 @@ namespace lconf { namespace json
     struct tag_as_const_raw_impl
     {
     public:
-        tag_as_const_raw_impl(T const* ptr, std::size_t size) : ptr(ptr), size(size)
+        tag_as_const_raw_impl(T const* ptr, std::size_t size, Encoding encoding) : ptr(ptr), size(size), encoding(encoding)
         {}
 
         T const* ptr;
         std::size_t size;
+        Encoding encoding;
     };
 
     //! Used to tag types as RAW
+    //! The binary contents are stored as a string, using
+    //!   the given encoding.
     template<typename T>
-    static tag_as_raw_impl<T> ref_as_raw(T*& ptr, std::size_t& size)
-    { return tag_as_raw_impl<T>(ptr, size); }
+    static tag_as_raw_impl<T> ref_as_raw(T*& ptr, std::size_t& size, Encoding encoding = Hex)
+    { return tag_as_raw_impl<T>(ptr, size, encoding); }
 
     template<typename T>
-    static tag_as_const_raw_impl<T> ref_as_raw(T const* ptr, std::size_t size)
-    { return tag_as_const_raw_impl<T>(ptr, size); }
+    static tag_as_const_raw_impl<T> ref_as_raw(T const* ptr, std::size_t size, Encoding encoding = Hex)
+    { return tag_as_const_raw_impl<T>(ptr, size, encoding); }
     
+    //! Element types of the vectors converted in bulk from and to
+    //!   packed arrays : those with a Number terminal (see below), so
+    //!   that the other arithmetic types are still rejected.
+    template <typename T>
+    struct isBulkNumber : std::false_type
+    {};
+
+    template <> struct isBulkNumber<int32_t> : std::true_type {};
+    template <> struct isBulkNumber<uint32_t> : std::true_type {};
+    template <> struct isBulkNumber<int64_t> : std::true_type {};
+    template <> struct isBulkNumber<uint64_t> : std::true_type {};
+    template <> struct isBulkNumber<float> : std::true_type {};
+    template <> struct isBulkNumber<double> : std::true_type {};
+
     //! Generic vector element.
     template <typename T>
     class Vector : public Element
@@ -363,29 +491,203 @@ namespace lconf { namespace json
         { return Element::Vector; }
         
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::Vector[const]::extract: extracting to const binding");
+                return status.fail(Status::BindingError, "json::Vector[const]::extract: extracting to const binding", node);
 
             if (node->type() != Node::Array)
-                throw Exception(node, "json::Vector::extract: expecting an array node");
-            
-            ArrayNode* arr = node->downcast<ArrayNode>();
+                return status.fail(Status::TypeError, "json::Vector::extract: expecting an array node", node);
             
+            ArrayNode const* arr = node->downcast<ArrayNode>();
+            return M_extract(arr, status, typename isBulkNumber<T>::type());
+        }
+
+        bool extract(Node* node, std::vector<Status>& errors) const
+        {
+            // Packed arrays are either fully extracted or rejected as a whole
+            if (m_is_const || node->type() != Node::Array ||
+                node->downcast<ArrayNode>()->storage() != ArrayNode::Generic)
+                return Element::extract(node, errors);
+
+            ArrayNode const* arr = node->downcast<ArrayNode>();
+            return M_extract(arr->impl(), errors, typename isBulkNumber<T>::type());
+        }
+
+        void extract(View const& view) const
+        {
+            if (m_is_const)
+                throw Exception(0, "json::Vector[const]::extract: extracting to const binding");
+
+            if (view.type() != Node::Array)
+                throw Exception(0, "json::Vector::extract: expecting an array node");
+
+            M_extract(view, typename isBulkNumber<T>::type());
+        }
+        
+        Node* synthetize() const
+        { return M_synthetize(typename isBulkNumber<T>::type()); }
+
+        bool isConst() const
+        { return m_is_const; }
+
+        void write(Writer& out) const
+        {
+            out.beginArray(multiline());
+            for (unsigned int i = 0; i < m_ref.size(); ++i)
+            {
+                Terminal<T> term(m_ref[i]);
+                term.write(out);
+            }
+            out.endArray();
+        }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        { M_write(out, fragment, previous, typename isBulkNumber<T>::type()); }
+
+        bool multiline() const
+        { return M_multiline(typename isBulkNumber<T>::type()); }
+        
+    private:
+        //! Generic extraction, through a Terminal<> per element.
+        bool M_extract(ArrayNode const* arr, Status& status, std::false_type) const
+        {
             m_ref.clear();
             m_ref.reserve(arr->size());
             for (unsigned int i = 0; i < arr->size(); ++i)
             {
                 T value;
                 Terminal<T> term(value);
-                term.extract(arr->at(i));
+                if (!static_cast<Element const&>(term).extract(arr->at(i), status))
+                {
+                    status.prefix(i);
+                    return false;
+                }
                 m_ref.push_back(value);
             }
+            return true;
         }
-        
-        Node* synthetize() const
+
+        //! Numeric extraction, converting the values straight
+        //!   into the vector's storage.
+        bool M_extract(ArrayNode const* arr, Status& status, std::true_type) const
+        {
+            // Packed arrays are converted without any intermediate node
+            if (arr->storage() == ArrayNode::Numbers)
+            {
+                std::vector<double> const& numbers = arr->numbers();
+                std::size_t size = numbers.size();
+
+                m_ref.resize(size);
+                T* data = m_ref.data();
+                for (std::size_t i = 0; i < size; ++i)
+                    data[i] = static_cast<T>(numbers[i]);
+                return true;
+            }
+
+            std::size_t size = arr->size();
+
+            m_ref.resize(size);
+            T* data = m_ref.data();
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                Node* item = arr->at(i);
+                if (item->type() != Node::Number)
+                {
+                    status.fail(Status::TypeError, "json::Vector::extract: expecting a node of type Number", item);
+                    status.prefix(i);
+                    return false;
+                }
+                data[i] = static_cast<T>(static_cast<NumberNode*>(item)->value());
+            }
+            return true;
+        }
+
+        //! Error collecting extractions (see Element), from the
+        //!   elements of a generic array.
+        bool M_extract(std::vector<Node*> const& items, std::vector<Status>& errors, std::false_type) const
+        {
+            std::size_t first = errors.size();
+
+            m_ref.clear();
+            m_ref.reserve(items.size());
+            for (std::size_t i = 0; i < items.size(); ++i)
+            {
+                T value = T();
+                Terminal<T> term(value);
+                std::size_t mark = errors.size();
+                if (!static_cast<Element const&>(term).extract(items[i], errors))
+                    prefix(errors, mark, i);
+                m_ref.push_back(value);
+            }
+            return errors.size() == first;
+        }
+
+        bool M_extract(std::vector<Node*> const& items, std::vector<Status>& errors, std::true_type) const
+        {
+            std::size_t first = errors.size();
+
+            m_ref.resize(items.size());
+            for (std::size_t i = 0; i < items.size(); ++i)
+            {
+                Node* item = items[i];
+                if (item->type() == Node::Number)
+                {
+                    m_ref[i] = static_cast<T>(static_cast<NumberNode*>(item)->value());
+                    continue;
+                }
+
+                errors.push_back(Status());
+                errors.back().fail(Status::TypeError, "json::Vector::extract: expecting a node of type Number", item);
+                errors.back().prefix(i);
+            }
+            return errors.size() == first;
+        }
+
+        void M_extract(View const& view, std::false_type) const
+        {
+            std::size_t size = view.size();
+            m_ref.clear();
+            m_ref.reserve(size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                T value;
+                Terminal<T> term(value);
+                static_cast<Element const&>(term).extract(view.at(i));
+                m_ref.push_back(value);
+            }
+        }
+
+        void M_extract(View const& view, std::true_type) const
+        {
+            std::size_t size = view.size();
+            m_ref.resize(size);
+            T* data = m_ref.data();
+
+            // Packed arrays are converted straight from the snapshot
+            if (double const* numbers = view.numbers())
+            {
+                for (std::size_t i = 0; i < size; ++i)
+                    data[i] = static_cast<T>(numbers[i]);
+                return;
+            }
+
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                View item = view.at(i);
+                if (item.type() != Node::Number)
+                    throw Exception(0, "json::Vector::extract: expecting a node of type Number");
+                data[i] = static_cast<T>(item.number());
+            }
+        }
+
+        //! Generic synthetization, through a Terminal<> per element.
+        ArrayNode* M_synthetize(std::false_type) const
         {
             ArrayNode* arr = new ArrayNode();
+            arr->impl().reserve(m_ref.size());
             for (unsigned int i = 0; i < m_ref.size(); ++i)
             {
                 Terminal<T> term(m_ref[i]);
@@ -394,9 +696,53 @@ namespace lconf { namespace json
             return arr;
         }
 
-        bool isConst() const
-        { return m_is_const; }
-        
+        //! Generic incremental write, element by element.
+        void M_write(Writer& out, Fragment& fragment, std::string const& previous, std::false_type) const
+        {
+            fragment.children.resize(m_ref.size());
+            out.beginArray(multiline());
+            for (unsigned int i = 0; i < m_ref.size(); ++i)
+            {
+                Terminal<T> term(m_ref[i]);
+                static_cast<Element const&>(term).write(out, fragment.children[i], previous);
+            }
+            out.endArray();
+        }
+
+        //! Numeric incremental write, the whole array being a leaf.
+        void M_write(Writer& out, Fragment& fragment, std::string const& previous, std::true_type) const
+        { Element::M_write(out, fragment, previous, m_ref.data(), m_ref.size() * sizeof(T)); }
+
+        bool M_multiline(std::false_type) const
+        {
+            for (unsigned int i = 0; i < m_ref.size(); ++i)
+            {
+                Terminal<T> term(m_ref[i]);
+                if (term.multiline())
+                    return true;
+            }
+            return false;
+        }
+
+        bool M_multiline(std::true_type) const
+        { return false; }
+
+        //! Numeric synthetization, into a packed array.
+        ArrayNode* M_synthetize(std::true_type) const
+        {
+            ArrayNode* arr = new ArrayNode(ArrayNode::Numbers);
+            arr->setSingle(std::is_same<T, float>::value);
+
+            std::vector<double>& numbers = arr->numbers();
+            std::size_t size = m_ref.size();
+            T const* data = m_ref.data();
+
+            numbers.resize(size);
+            for (std::size_t i = 0; i < size; ++i)
+                numbers[i] = static_cast<double>(data[i]);
+            return arr;
+        }
+
     private:
         std::vector<T>& m_ref;
         bool m_is_const;
@@ -421,24 +767,72 @@ namespace lconf { namespace json
         { return Element::Map; }
         
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::Map[const]::extract: extracting to const binding");
+                return status.fail(Status::BindingError, "json::Map[const]::extract: extracting to const binding", node);
 
             if (node->type() != Node::Object)
-                throw Exception(node, "json::Map::extract: expecting an object node");
+                return status.fail(Status::TypeError, "json::Map::extract: expecting an object node", node);
             
-            ObjectNode* obj = node->downcast<ObjectNode>();
+            ObjectNode const* obj = node->downcast<ObjectNode>();
             
             m_ref.clear();
-            for (std::map<std::string, Node*>::iterator it = obj->impl().begin();
+            for (std::map<std::string, Node*>::const_iterator it = obj->impl().begin();
                 it != obj->impl().end(); ++it)
             {
                 T value;
                 Terminal<T> term(value);
-                term.extract(it->second);
+                if (!static_cast<Element const&>(term).extract(it->second, status))
+                {
+                    status.prefix(it->first);
+                    return false;
+                }
                 m_ref[it->first] = value;
             }
+            return true;
+        }
+
+        bool extract(Node* node, std::vector<Status>& errors) const
+        {
+            if (m_is_const || node->type() != Node::Object)
+                return Element::extract(node, errors);
+
+            ObjectNode const* obj = node->downcast<ObjectNode>();
+            std::size_t first = errors.size();
+
+            m_ref.clear();
+            for (std::map<std::string, Node*>::const_iterator it = obj->impl().begin();
+                it != obj->impl().end(); ++it)
+            {
+                T value = T();
+                Terminal<T> term(value);
+                std::size_t mark = errors.size();
+                if (!static_cast<Element const&>(term).extract(it->second, errors))
+                    prefix(errors, mark, it->first);
+                m_ref[it->first] = value;
+            }
+            return errors.size() == first;
+        }
+
+        void extract(View const& view) const
+        {
+            if (m_is_const)
+                throw Exception(0, "json::Map[const]::extract: extracting to const binding");
+
+            if (view.type() != Node::Object)
+                throw Exception(0, "json::Map::extract: expecting an object node");
+
+            m_ref.clear();
+            for (std::size_t i = 0; i < view.size(); ++i)
+            {
+                T value;
+                Terminal<T> term(value);
+                static_cast<Element const&>(term).extract(view.at(i));
+                m_ref.insert(m_ref.end(), std::make_pair(view.key(i), value));
+            }
         }
         
         Node* synthetize() const
@@ -456,6 +850,37 @@ namespace lconf { namespace json
 
         bool isConst() const
         { return m_is_const; }
+
+        void write(Writer& out) const
+        {
+            out.beginObject();
+            for (typename std::map<std::string, T>::iterator it = m_ref.begin();
+                it != m_ref.end(); ++it)
+            {
+                Terminal<T> term(it->second);
+                out.key(it->first);
+                term.write(out);
+            }
+            out.endObject();
+        }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        {
+            fragment.children.resize(m_ref.size());
+            out.beginObject();
+            std::size_t i = 0;
+            for (typename std::map<std::string, T>::iterator it = m_ref.begin();
+                it != m_ref.end(); ++it, ++i)
+            {
+                Terminal<T> term(it->second);
+                out.key(it->first);
+                static_cast<Element const&>(term).write(out, fragment.children[i], previous);
+            }
+            out.endObject();
+        }
+
+        bool multiline() const
+        { return true; }
         
     private:
         std::map<std::string, T>& m_ref;
@@ -594,7 +1019,7 @@ namespace lconf { namespace json
     class Terminal<tag_as_pod_impl<T> > : public POD<T>
     {
     public:
-        Terminal(tag_as_pod_impl<T> ref) : POD<T>(ref.ref)
+        Terminal(tag_as_pod_impl<T> ref) : POD<T>(ref.ref, ref.encoding)
         {}
     };
 
@@ -602,7 +1027,7 @@ namespace lconf { namespace json
     class Terminal<tag_as_const_pod_impl<T> > : public POD<T>
     {
     public:
-        Terminal(tag_as_const_pod_impl<T> ref) : POD<T>(ref.ref)
+        Terminal(tag_as_const_pod_impl<T> ref) : POD<T>(ref.ref, ref.encoding)
         {}
     };
 
@@ -610,7 +1035,7 @@ namespace lconf { namespace json
     class Terminal<tag_as_raw_impl<T> > : public Raw<T>
     {
     public:
-        Terminal(tag_as_raw_impl<T> ref) : Raw<T>(ref.ptr, ref.size)
+        Terminal(tag_as_raw_impl<T> ref) : Raw<T>(ref.ptr, ref.size, ref.encoding)
         {}
     };
 
@@ -618,7 +1043,7 @@ namespace lconf { namespace json
     class Terminal<tag_as_const_raw_impl<T> > : public Raw<T>
     {
     public:
-        Terminal(tag_as_const_raw_impl<T> ref) : Raw<T>(ref.ptr, ref.size)
+        Terminal(tag_as_const_raw_impl<T> ref) : Raw<T>(ref.ptr, ref.size, ref.encoding)
         {}
     };
     
@@ -632,8 +1057,14 @@ namespace lconf { namespace json
         void bind(std::string const& name, Element* elem);
         Type type() const;
         void extract(Node* node) const;
+        bool extract(Node* node, Status& status) const;
+        bool extract(Node* node, std::vector<Status>& errors) const;
+        void extract(View const& view) const;
         Node* synthetize() const;
         bool isConst() const;
+        void write(Writer& out) const;
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const;
+        bool multiline() const;
         
     private:
         std::map<std::string, Element*> m_elements;
@@ -649,8 +1080,14 @@ namespace lconf { namespace json
         void bind(Element* elem);
         Type type() const;
         void extract(Node* node) const;
+        bool extract(Node* node, Status& status) const;
+        bool extract(Node* node, std::vector<Status>& errors) const;
+        void extract(View const& view) const;
         Node* synthetize() const;
         bool isConst() const;
+        void write(Writer& out) const;
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const;
+        bool multiline() const;
         
     private:
         std::vector<Element*> m_elements;
@@ -708,7 +1145,21 @@ namespace lconf { namespace json
         bool bound() const;
         
         void extract(Node* node) const;
+        //! Extract without throwing : returns false on failure, with
+        //!   the error described by status (see Status), which is
+        //!   reset otherwise.
+        bool extract(Node* node, Status& status) const;
+        //! Bulk validation : extract as much as possible, going on after
+        //!   errors, and return false if there is any. Errors are stored
+        //!   in errors, objects reporting theirs in key order.
+        bool extract(Node* node, std::vector<Status>& errors) const;
+        //! Extract from a snapshot, in place.
+        void extract(View const& view) const;
         Node* synthetize() const;
+        //! Write the bound data to a streaming writer.
+        void write(Writer& out) const;
+        //! Incremental write (see Incremental).
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const;
         
     private:
         Element* m_impl;
@@ -740,13 +1191,27 @@ namespace lconf { namespace json
         { return Element::Scalar; }
         
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::Scalar[const]::extract: extracting to const binding");
+                return status.fail(Status::BindingError, "json::Scalar[const]::extract: extracting to const binding", node);
 
             if (node->type() != tp)
-                throw Exception(node, "json::Scalar::extract: expecting a node of type " + Node::typeName(tp));
+                return status.fail(Status::TypeError, "json::Scalar::extract: expecting a node of type " + Node::typeName(tp), node);
             *m_ref = node->downcast<N>()->value();
+            return true;
+        }
+
+        void extract(View const& view) const
+        {
+            if (m_is_const)
+                throw Exception(0, "json::Scalar[const]::extract: extracting to const binding");
+
+            if (view.type() != tp)
+                throw Exception(0, "json::Scalar::extract: expecting a node of type " + Node::typeName(tp));
+            *m_ref = viewValue(view, (N*) 0);
         }
         
         Node* synthetize() const
@@ -754,6 +1219,18 @@ namespace lconf { namespace json
 
         bool isConst() const
         { return m_is_const; }
+
+        void write(Writer& out) const
+        { out.value(static_cast<bool>(*m_ref)); }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        {
+            bool value = *m_ref;
+            M_write(out, fragment, previous, &value, sizeof(bool));
+        }
+
+        bool multiline() const
+        { return false; }
         
     protected:
         std::vector<bool>::reference* m_ref;
@@ -787,14 +1264,24 @@ namespace lconf { namespace json
         { return Element::Vector; }
         
         void extract(Node* node) const
+        { M_extractOrThrow(node); }
+
+        bool extract(Node* node, Status& status) const
         {
             if (m_is_const)
-                throw Exception(node, "json::Vector[const]::extract: extracting to const binding");
+                return status.fail(Status::BindingError, "json::Vector[const]::extract: extracting to const binding", node);
 
             if (node->type() != Node::Array)
-                throw Exception(node, "json::Vector::extract: expecting an array node");
+                return status.fail(Status::TypeError, "json::Vector::extract: expecting an array node", node);
+            
+            ArrayNode const* arr = node->downcast<ArrayNode>();
             
-            ArrayNode* arr = node->downcast<ArrayNode>();
+            // Packed arrays are copied without any intermediate node
+            if (arr->storage() == ArrayNode::Booleans)
+            {
+                m_ref = arr->booleans();
+                return true;
+            }
             
             m_ref.clear();
             m_ref.reserve(arr->size());
@@ -802,24 +1289,93 @@ namespace lconf { namespace json
             {
                 bool value;
                 Terminal<bool> term(value);
-                term.extract(arr->at(i));
+                if (!static_cast<Element const&>(term).extract(arr->at(i), status))
+                {
+                    status.prefix(i);
+                    return false;
+                }
                 m_ref.push_back(value);
             }
+            return true;
         }
-        
-        Node* synthetize() const
+
+        bool extract(Node* node, std::vector<Status>& errors) const
         {
-            ArrayNode* arr = new ArrayNode();
-            for (unsigned int i = 0; i < m_ref.size(); ++i)
+            // Packed arrays are either fully extracted or rejected as a whole
+            if (m_is_const || node->type() != Node::Array ||
+                node->downcast<ArrayNode>()->storage() != ArrayNode::Generic)
+                return Element::extract(node, errors);
+
+            ArrayNode const* arr = node->downcast<ArrayNode>();
+            std::vector<Node*> const& items = arr->impl();
+            std::size_t first = errors.size();
+
+            m_ref.clear();
+            m_ref.reserve(items.size());
+            for (std::size_t i = 0; i < items.size(); ++i)
             {
-                Terminal<std::vector<bool>::reference> term(m_ref[i]);
-                arr->impl().push_back(term.synthetize());
+                bool value = false;
+                Terminal<bool> term(value);
+                std::size_t mark = errors.size();
+                if (!static_cast<Element const&>(term).extract(items[i], errors))
+                    prefix(errors, mark, i);
+                m_ref.push_back(value);
             }
+            return errors.size() == first;
+        }
+
+        void extract(View const& view) const
+        {
+            if (m_is_const)
+                throw Exception(0, "json::Vector[const]::extract: extracting to const binding");
+
+            if (view.type() != Node::Array)
+                throw Exception(0, "json::Vector::extract: expecting an array node");
+
+            std::size_t size = view.size();
+            if (uint8_t const* booleans = view.booleans())
+            {
+                m_ref.assign(booleans, booleans + size);
+                return;
+            }
+
+            m_ref.clear();
+            m_ref.reserve(size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                bool value;
+                Terminal<bool> term(value);
+                term.extract(view.at(i));
+                m_ref.push_back(value);
+            }
+        }
+        
+        Node* synthetize() const
+        {
+            ArrayNode* arr = new ArrayNode(ArrayNode::Booleans);
+            arr->booleans() = m_ref;
             return arr;
         }
 
         bool isConst() const
         { return m_is_const; }
+
+        void write(Writer& out) const
+        {
+            out.beginArray();
+            for (unsigned int i = 0; i < m_ref.size(); ++i)
+                out.value(static_cast<bool>(m_ref[i]));
+            out.endArray();
+        }
+
+        void write(Writer& out, Fragment& fragment, std::string const& previous) const
+        {
+            std::string shadow(m_ref.begin(), m_ref.end());
+            M_write(out, fragment, previous, shadow.data(), shadow.size());
+        }
+
+        bool multiline() const
+        { return false; }
         
     private:
         std::vector<bool>& m_ref;
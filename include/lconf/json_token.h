@@ -20,6 +20,7 @@
 #define LCONF_JSON_TOKEN_H
 
 #include <string>
+#include <cstddef>
 
 namespace lconf { namespace json
 {
@@ -38,15 +39,18 @@ namespace lconf { namespace json
             Colon,
             True,
             False,
+            Null,
             Number,
             String,
             Include
         };
 
+        //! Position of the token, as a byte offset in the input
+        //!   (see Lexer::position() for lines and columns).
         struct Info
         {
             bool empty;
-            int line, column;
+            std::size_t offset;
         };
 
     public:
@@ -0,0 +1,132 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_VALUE_H
+#define LCONF_JSON_VALUE_H
+
+#include "lconf/json_node.h"
+#include "lconf/json_writer.h"
+#include "lconf/json_path.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstddef>
+
+namespace lconf { namespace json
+{
+    //! Persistent JSON value.
+    //! Values are immutable : updates return a new value sharing all the
+    //!   unchanged subtrees with the original one (only the containers
+    //!   along the updated path are copied). Copying a value is just a
+    //!   reference count increment, and values can be read from several
+    //!   threads at once, so that each reader can keep a stable version
+    //!   of a configuration while it is being updated.
+    //! Assigning a Value is not atomic though, and a variable holding the
+    //!   current version must be protected (for instance by a mutex, the
+    //!   copy made under the lock being cheap).
+    //! Costs to keep in mind :
+    //!   - each element of an array is a separate value, so packed
+    //!     arrays of numbers or booleans (see ArrayNode) are expanded
+    //!     to one heap block per element, and only packed again by
+    //!     node() ;
+    //!   - arrays and objects are persistent B-trees of 32-element
+    //!     chunks : an update copies one chunk per level, so set(),
+    //!     remove() and append() cost O(log N), as do at() and key(),
+    //!     while a lookup by key costs O(log N) calls to key() ;
+    //!     removals do not merge chunks back together ;
+    //!   - the conversions from and to trees, write() and destruction
+    //!     recurse over the nesting depth, like the tree destruction
+    //!     does, so very deep documents may exhaust the stack.
+    class Value
+    {
+    public:
+        //! Build a null value.
+        Value();
+        Value(double value, bool single = false);
+        Value(int value);
+        Value(bool value);
+        Value(std::string const& value);
+        Value(char const* value);
+        //! Build a value from the tree whose root is node.
+        explicit Value(Node const* node);
+
+        static Value object();
+        static Value array();
+
+        Node::Type type() const;
+        double number() const;
+        bool isSingle() const;
+        bool boolean() const;
+        std::string const& string() const;
+        //! Get the number of elements of an object or array.
+        std::size_t size() const;
+
+        //! Object entries, sorted by key.
+        std::string const& key(std::size_t i) const;
+        bool exists(std::string const& key) const;
+        //! Get the value associated with key.
+        //! Throws a std::domain_error if there is no such entry.
+        Value get(std::string const& key) const;
+        //! Get the i-th element of an array, or the i-th
+        //!   entry value of an object.
+        Value at(std::size_t i) const;
+        //! Get the value at path (see Path, which must be a plain
+        //!   pointer), returning false if there is none.
+        bool find(Path const& path, Value& value) const;
+
+        //! Updated copies of an object.
+        Value set(std::string const& key, Value const& value) const;
+        Value remove(std::string const& key) const;
+        //! Updated copies of an array.
+        Value set(std::size_t i, Value const& value) const;
+        Value remove(std::size_t i) const;
+        Value append(Value const& value) const;
+        //! Updated copy of the value at path. The parent of the updated
+        //!   value must exist, and the last segment can be the index
+        //!   past the end of an array ("-" or its size) to append.
+        Value set(Path const& path, Value const& value) const;
+        Value remove(Path const& path) const;
+
+        //! Tell if both values are the same shared instance (unchanged
+        //!   subtrees of updated values are).
+        bool same(Value const& other) const;
+
+        //! Build a JSON tree from this value.
+        Node* node() const;
+        void write(Writer& out) const;
+        void serialize(std::ostream& out, bool indent = true) const;
+        void serialize(std::ostream& out, Format format) const;
+
+    private:
+        struct Data;
+
+        Value(std::shared_ptr<Data const> const& data);
+
+        Data const& M_data(Node::Type type, char const* what) const;
+        Value const* M_entry(std::string const& key) const;
+        bool M_multiline() const;
+        Value M_set(Path const& path, std::size_t i, Value const& value) const;
+        Value M_remove(Path const& path, std::size_t i) const;
+
+    private:
+        std::shared_ptr<Data const> m_data;
+    };
+} }
+
+#endif // LCONF_JSON_VALUE_H
@@ -0,0 +1,146 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCONF_JSON_WRITER_H
+#define LCONF_JSON_WRITER_H
+
+#include "lconf/json_buffer.h"
+#include <string>
+#include <vector>
+
+namespace lconf { namespace json
+{
+    class Node;
+
+    //! Output formats.
+    enum Format
+    {
+        //! Objects and arrays of objects span multiple lines.
+        Indented,
+        //! Single-line output.
+        Compact,
+        //! Minified single-line output, without any space, and with numbers
+        //!   written as the shortest form of their double value (so that
+        //!   -0 is written as 0, and single precision is ignored).
+        //! Trees (whose object keys are sorted) have a unique canonical
+        //!   form, suitable for hashing and byte-for-byte comparison.
+        Canonical
+    };
+
+    //! Streaming JSON writer.
+    //! Values are written to the buffer as soon as they are given,
+    //!   with the same layout as Node::serialize().
+    class Writer
+    {
+    public:
+        Writer(Buffer& out, bool indent = true);
+        Writer(Buffer& out, Format format);
+        ~Writer();
+
+        //! Objects span multiple lines when indenting.
+        void beginObject();
+        void endObject();
+        //! Arrays span multiple lines when indenting only if multiline
+        //!   is set (the serializer does so for arrays containing objects
+        //!   or multiline arrays).
+        void beginArray(bool multiline = false);
+        void endArray();
+        //! Write the key of the next object entry.
+        void key(std::string const& key);
+
+        //! Write scalar values (see NumberNode for single).
+        void value(double value, bool single = false);
+        void value(float value);
+        void value(int value);
+        void value(unsigned int value);
+        void value(long value);
+        void value(unsigned long value);
+        void value(long long value);
+        void value(unsigned long long value);
+        void value(bool value);
+        void value(std::string const& value);
+        void value(char const* value);
+        void null();
+
+        //! Write a whole JSON tree.
+        void node(Node const* node);
+
+        //! Write what comes before the next value (separator and
+        //!   indentation), so that the value starts at the current
+        //!   position of the buffer (see Incremental).
+        //! multiline must be the one of the value.
+        void prefix(bool multiline);
+        //! Write an already formatted value, as previously written at
+        //!   the same place of the document.
+        void splice(char const* data, std::size_t size);
+        //! Get the current position in the buffer.
+        std::size_t position() const;
+
+    private:
+        bool M_beginValue(bool multiline, int& level);
+        void M_number(double value, bool single);
+        void M_string(char const* value, std::size_t size);
+
+    private:
+        //! An object or array being written.
+        struct Frame
+        {
+            bool object;
+            bool multiline;
+            int level;
+            std::size_t count;
+        };
+
+    private:
+        Buffer& m_out;
+        bool m_indent;
+        bool m_canonical;
+        std::vector<Frame> m_frames;
+
+        //! Set by prefix() for the next value.
+        bool m_prefixed;
+        bool m_prefixIndented;
+        int m_prefixLevel;
+    };
+
+    inline void Writer::value(double value, bool single)
+    { M_number(value, single); }
+
+    inline void Writer::value(float value)
+    { M_number(value, true); }
+
+    inline void Writer::value(int value)
+    { M_number(value, false); }
+
+    inline void Writer::value(unsigned int value)
+    { M_number(value, false); }
+
+    inline void Writer::value(long value)
+    { M_number(value, false); }
+
+    inline void Writer::value(unsigned long value)
+    { M_number(value, false); }
+
+    inline void Writer::value(long long value)
+    { M_number(value, false); }
+
+    inline void Writer::value(unsigned long long value)
+    { M_number(value, false); }
+} }
+
+#endif // LCONF_JSON_WRITER_H
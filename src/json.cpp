@@ -21,8 +21,58 @@
 
 namespace lconf { namespace json
 {
+    namespace
+    {
+        //! Write a template, streamed except for the canonical
+        //!   format which needs sorted keys.
+        void writeTemplate(Template const& tpl, Buffer& out, Format format)
+        {
+            if (format != Canonical)
+            {
+                Writer writer(out, format);
+                tpl.write(writer);
+                return;
+            }
+
+            Node* node = tpl.synthetize();
+            try
+            {
+                node->serialize(out, format);
+            }
+            catch (...)
+            {
+                delete node;
+                throw;
+            }
+            delete node;
+        }
+
+        //! Extract from a parsed tree, and delete it.
+        bool extractParsed(Template const& tpl, Node* node, Status& status)
+        {
+            bool ok;
+            try
+            {
+                ok = tpl.extract(node, status);
+            }
+            catch (...)
+            {
+                delete node;
+                throw;
+            }
+            delete node;
+
+            // The offending node is gone
+            status.node = 0;
+            return ok;
+        }
+    }
+
     Node* parse(std::string const& file)
     {
+        if (cacheEnabled())
+            return parseCached(file);
+
         std::ifstream fs(file, std::ios::in);
         if (!fs)
             throw std::logic_error("json::parse: unable to open \"" + file + "\"");
@@ -36,17 +86,35 @@ namespace lconf { namespace json
         return parser.parse();
     }
 
-    void serialize(Node* node, std::string const& file, bool indent)
+    void serialize(Node* node, std::string const& file, bool indent, int flags)
+    {
+        serialize(node, file, indent ? Indented : Compact, flags);
+    }
+
+    void serialize(Node* node, std::ostream& file, bool indent)
     {
+        node->serialize(file, indent);
+    }
+
+    void serialize(Node* node, std::string const& file, Format format, int flags)
+    {
+        if (flags)
+        {
+            Buffer buffer;
+            node->serialize(buffer, format);
+            writeFile(file, buffer.str().data(), buffer.size(), flags);
+            return;
+        }
+
         std::ofstream fs(file, std::ios::out);
         if (!fs)
             throw std::logic_error("json::serialize: unable to open\"" + file + "\"");
-        serialize(node, fs, indent);
+        serialize(node, fs, format);
     }
 
-    void serialize(Node* node, std::ostream& file, bool indent)
+    void serialize(Node* node, std::ostream& file, Format format)
     {
-        node->serialize(file, indent);
+        node->serialize(file, format);
     }
 
     void extract(Template const& tpl, std::string const& file)
@@ -63,17 +131,220 @@ namespace lconf { namespace json
         delete node;
     }
 
-    void synthetize(Template const& tpl, std::string const& file, bool indent)
+    Node* tryParse(std::string const& file, Status& status)
     {
-        Node* node = tpl.synthetize();
-        serialize(node, file, indent);
+        if (cacheEnabled())
+            return parseCached(file, status);
+
+        std::ifstream fs(file, std::ios::in);
+        if (!fs)
+        {
+            status.fail(Status::IoError, "json::parse: unable to open \"" + file + "\"");
+            return 0;
+        }
+        return tryParse(fs, status);
+    }
+
+    Node* tryParse(std::istream& file, Status& status)
+    {
+        Lexer lexer(file);
+        Parser parser(lexer);
+        return parser.parse(status);
+    }
+
+    bool tryExtract(Template const& tpl, std::string const& file, Status& status)
+    {
+        Node* node = tryParse(file, status);
+        if (!node)
+            return false;
+        return extractParsed(tpl, node, status);
+    }
+
+    bool tryExtract(Template const& tpl, std::istream& file, Status& status)
+    {
+        Node* node = tryParse(file, status);
+        if (!node)
+            return false;
+        return extractParsed(tpl, node, status);
+    }
+
+    bool validate(Template const& tpl, std::string const& file, std::vector<Status>& errors)
+    {
+        std::ifstream fs(file, std::ios::in);
+        if (!fs)
+        {
+            errors.assign(1, Status());
+            return errors.back().fail(Status::IoError, "json::parse: unable to open \"" + file + "\"");
+        }
+        return validate(tpl, fs, errors);
+    }
+
+    bool validate(Template const& tpl, std::istream& file, std::vector<Status>& errors)
+    {
+        Lexer lexer(file);
+        Parser parser(lexer);
+        Node* node = parser.parse(errors);
+        if (!node)
+            return false;
+
+        std::vector<Status> extraction;
+        try
+        {
+            tpl.extract(node, extraction);
+        }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
+
+        // Locate the offending nodes, which do not outlive this call
+        //   (or their closest parsed parent, for the elements of
+        //   packed arrays)
+        for (std::size_t i = 0; i < extraction.size(); ++i)
+        {
+            Status& error = extraction[i];
+            std::string path = error.path;
+            Node* at = error.node;
+            while (!parser.position(at, error.line, error.column) && !path.empty())
+            {
+                path.erase(path.rfind('/'));
+                at = Path(path, false).find(node);
+            }
+            error.node = 0;
+        }
         delete node;
+
+        errors.insert(errors.end(), extraction.begin(), extraction.end());
+        return errors.empty();
+    }
+
+    void synthetize(Template const& tpl, std::string const& file, bool indent, int flags)
+    {
+        synthetize(tpl, file, indent ? Indented : Compact, flags);
     }
 
     void synthetize(Template const& tpl, std::ostream& file, bool indent)
+    {
+        synthetize(tpl, file, indent ? Indented : Compact);
+    }
+
+    void synthetize(Template const& tpl, std::string const& file, Format format, int flags)
+    {
+        if (flags)
+        {
+            Buffer buffer;
+            writeTemplate(tpl, buffer, format);
+            writeFile(file, buffer.str().data(), buffer.size(), flags);
+            return;
+        }
+
+        std::ofstream fs(file, std::ios::out);
+        if (!fs)
+            throw std::logic_error("json::synthetize: unable to open\"" + file + "\"");
+        synthetize(tpl, fs, format);
+    }
+
+    void synthetize(Template const& tpl, std::ostream& file, Format format)
+    {
+        Buffer buffer(file);
+        writeTemplate(tpl, buffer, format);
+        buffer.flush();
+    }
+
+    Node* parseBinary(std::string const& file)
+    {
+        std::ifstream fs(file, std::ios::in | std::ios::binary);
+        if (!fs)
+            throw std::logic_error("json::parseBinary: unable to open \"" + file + "\"");
+        return parseBinary(fs);
+    }
+
+    Node* parseBinary(std::istream& file)
+    {
+        return decodeBinary(file);
+    }
+
+    void serializeBinary(Node* node, std::string const& file, int flags)
+    {
+        if (flags)
+        {
+            Buffer buffer;
+            encodeBinary(node, buffer);
+            writeFile(file, buffer.str().data(), buffer.size(), flags);
+            return;
+        }
+
+        std::ofstream fs(file, std::ios::out | std::ios::binary);
+        if (!fs)
+            throw std::logic_error("json::serializeBinary: unable to open\"" + file + "\"");
+        serializeBinary(node, fs);
+    }
+
+    void serializeBinary(Node* node, std::ostream& file)
+    {
+        Buffer buffer(file);
+        encodeBinary(node, buffer);
+        buffer.flush();
+    }
+
+    void extractBinary(Template const& tpl, std::string const& file)
+    {
+        Node* node = parseBinary(file);
+        try
+        {
+            tpl.extract(node);
+        }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
+        delete node;
+    }
+
+    void extractBinary(Template const& tpl, std::istream& file)
+    {
+        Node* node = parseBinary(file);
+        try
+        {
+            tpl.extract(node);
+        }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
+        delete node;
+    }
+
+    void synthetizeBinary(Template const& tpl, std::string const& file, int flags)
+    {
+        Node* node = tpl.synthetize();
+        try
+        {
+            serializeBinary(node, file, flags);
+        }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
+        delete node;
+    }
+
+    void synthetizeBinary(Template const& tpl, std::ostream& file)
     {
         Node* node = tpl.synthetize();
-        serialize(node, file, indent);
+        try
+        {
+            serializeBinary(node, file);
+        }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
         delete node;
     }
 } }
@@ -0,0 +1,493 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_binary.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    char const magic[4] = { 'L', 'C', 'B', '1' };
+
+    //! Nesting depth of decoded documents, so that malformed data
+    //!   can not exhaust the stack.
+    std::size_t const maxDepth = 1024;
+
+    //! Integral doubles with a magnitude below 2^53 are stored as varints.
+    double const maxInteger = 9007199254740992.0;
+
+    bool isInteger(double value)
+    {
+        return value > -maxInteger && value < maxInteger &&
+            value == (double) (int64_t) value &&
+            !(value == 0 && std::signbit(value));
+    }
+
+    template <typename T>
+    void swapBytes(T& value)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        char* bytes = (char*) &value;
+        for (std::size_t i = 0; i < sizeof(T) / 2; ++i)
+            std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+#else
+        (void) value;
+#endif
+    }
+
+    class Encoder
+    {
+    public:
+        Encoder(Buffer& out) :
+            m_out(out)
+        {}
+
+        void node(Node const* node)
+        {
+            switch (node->type())
+            {
+                case Node::Boolean:
+                    m_out.put(((BooleanNode const*) node)->value() ? BinaryTrue : BinaryFalse);
+                    break;
+
+                case Node::Number:
+                {
+                    NumberNode const* num = (NumberNode const*) node;
+                    number(num->value(), num->isSingle());
+                    break;
+                }
+
+                case Node::String:
+                {
+                    std::string const& str = ((StringNode const*) node)->value();
+                    m_out.put(BinaryString);
+                    string(str);
+                    break;
+                }
+
+                case Node::Object:
+                {
+                    std::map<std::string, Node*> const& impl = ((ObjectNode const*) node)->impl();
+                    m_out.put(BinaryObject);
+                    varint(impl.size());
+                    for (std::map<std::string, Node*>::const_iterator it = impl.begin();
+                         it != impl.end(); ++it)
+                    {
+                        string(it->first);
+                        this->node(it->second);
+                    }
+                    break;
+                }
+
+                case Node::Array:
+                    array((ArrayNode const*) node);
+                    break;
+
+                case Node::Null:
+                    m_out.put(BinaryNull);
+                    break;
+            }
+        }
+
+    private:
+        void array(ArrayNode const* arr)
+        {
+            if (arr->storage() == ArrayNode::Booleans)
+            {
+                std::vector<bool> const& values = arr->booleans();
+                m_out.put(BinaryBooleans);
+                varint(values.size());
+                for (std::size_t i = 0; i < values.size(); i += 8)
+                {
+                    unsigned char byte = 0;
+                    for (std::size_t j = i; j < i + 8 && j < values.size(); ++j)
+                        byte |= values[j] << (j - i);
+                    m_out.put(byte);
+                }
+            }
+            else if (arr->storage() == ArrayNode::Numbers)
+            {
+                std::vector<double> const& values = arr->numbers();
+
+                if (arr->isSingle())
+                {
+                    m_out.put(BinarySingles);
+                    varint(values.size());
+                    for (std::size_t i = 0; i < values.size(); ++i)
+                        raw((float) values[i]);
+                    return;
+                }
+
+                bool integers = true;
+                for (std::size_t i = 0; integers && i < values.size(); ++i)
+                    integers = isInteger(values[i]);
+
+                if (integers)
+                {
+                    m_out.put(BinaryIntegers);
+                    varint(values.size());
+                    for (std::size_t i = 0; i < values.size(); ++i)
+                        zigzag((int64_t) values[i]);
+                }
+                else
+                {
+                    m_out.put(BinaryDoubles);
+                    varint(values.size());
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                    for (std::size_t i = 0; i < values.size(); ++i)
+                        raw(values[i]);
+#else
+                    if (!values.empty())
+                        m_out.write((char const*) &values[0], values.size() * sizeof(double));
+#endif
+                }
+            }
+            else
+            {
+                std::vector<Node*> const& impl = arr->impl();
+                m_out.put(BinaryArray);
+                varint(impl.size());
+                for (std::size_t i = 0; i < impl.size(); ++i)
+                    node(impl[i]);
+            }
+        }
+
+        void number(double value, bool single)
+        {
+            if (single)
+            {
+                m_out.put(BinarySingle);
+                raw((float) value);
+            }
+            else if (isInteger(value))
+            {
+                m_out.put(BinaryInteger);
+                zigzag((int64_t) value);
+            }
+            else
+            {
+                m_out.put(BinaryDouble);
+                raw(value);
+            }
+        }
+
+        void string(std::string const& str)
+        {
+            varint(str.size());
+            m_out.write(str);
+        }
+
+        void varint(uint64_t value)
+        {
+            char bytes[10];
+            std::size_t size = 0;
+            while (value >= 0x80)
+            {
+                bytes[size++] = (char) (value | 0x80);
+                value >>= 7;
+            }
+            bytes[size++] = (char) value;
+            m_out.write(bytes, size);
+        }
+
+        void zigzag(int64_t value)
+        { varint(((uint64_t) value << 1) ^ (uint64_t) (value >> 63)); }
+
+        template <typename T>
+        void raw(T value)
+        {
+            swapBytes(value);
+            m_out.write((char const*) &value, sizeof(T));
+        }
+
+    private:
+        Buffer& m_out;
+    };
+
+    class Decoder
+    {
+    public:
+        Decoder(char const* data, std::size_t size) :
+            m_ptr((unsigned char const*) data),
+            m_end((unsigned char const*) data + size),
+            m_depth(0)
+        {}
+
+        void header()
+        {
+            if (m_end - m_ptr < 4 || std::memcmp(m_ptr, magic, 4))
+                throw std::logic_error("json::decodeBinary: bad magic number");
+            m_ptr += 4;
+        }
+
+        void finish()
+        {
+            if (m_ptr != m_end)
+                throw std::logic_error("json::decodeBinary: trailing data");
+        }
+
+        Node* node()
+        {
+            switch (byte())
+            {
+                case BinaryFalse:
+                    return new BooleanNode(false);
+                case BinaryTrue:
+                    return new BooleanNode(true);
+                case BinaryNull:
+                    return new NullNode();
+                case BinaryInteger:
+                    return new NumberNode((double) zigzag());
+                case BinaryDouble:
+                    return new NumberNode(raw<double>());
+                case BinarySingle:
+                    return new NumberNode(raw<float>());
+                case BinaryString:
+                    return new StringNode(string());
+                case BinaryObject:
+                case BinaryArray:
+                    return container(m_ptr[-1]);
+                case BinaryIntegers:
+                case BinaryDoubles:
+                case BinarySingles:
+                case BinaryBooleans:
+                    return packed(m_ptr[-1]);
+                default:
+                    throw std::logic_error("json::decodeBinary: unknown tag");
+            }
+        }
+
+    private:
+        Node* container(unsigned char tag)
+        {
+            if (m_depth == maxDepth)
+                throw std::logic_error("json::decodeBinary: document nested too deeply");
+
+            ++m_depth;
+            Node* node = tag == BinaryObject ? object() : array();
+            --m_depth;
+            return node;
+        }
+
+        Node* object()
+        {
+            uint64_t count = varint();
+            ObjectNode* obj = new ObjectNode();
+            try
+            {
+                // Keys are written in order, so each entry is
+                //   inserted at the end of the map
+                std::map<std::string, Node*>& impl = obj->impl();
+                for (uint64_t i = 0; i < count; ++i)
+                {
+                    std::string key = string();
+                    Node* child = node();
+                    std::map<std::string, Node*>::iterator it = impl.lower_bound(key);
+                    if (it != impl.end() && it->first == key)
+                    {
+                        delete it->second;
+                        it->second = child;
+                    }
+                    else
+                        impl.insert(it, std::make_pair(key, child));
+                }
+            }
+            catch (...)
+            {
+                delete obj;
+                throw;
+            }
+            return obj;
+        }
+
+        Node* array()
+        {
+            uint64_t count = varint();
+            ArrayNode* arr = new ArrayNode();
+            try
+            {
+                // Every element takes at least one byte
+                need(count);
+                std::vector<Node*>& impl = arr->impl();
+                impl.reserve(count);
+                for (uint64_t i = 0; i < count; ++i)
+                    impl.push_back(node());
+            }
+            catch (...)
+            {
+                delete arr;
+                throw;
+            }
+            return arr;
+        }
+
+        Node* packed(unsigned char tag)
+        {
+            uint64_t count = varint();
+
+            if (tag == BinaryBooleans)
+            {
+                need((count + 7) / 8);
+                ArrayNode* arr = new ArrayNode(ArrayNode::Booleans);
+                std::vector<bool>& values = arr->booleans();
+                values.resize(count);
+                for (uint64_t i = 0; i < count; ++i)
+                    values[i] = (m_ptr[i / 8] >> (i % 8)) & 1;
+                m_ptr += (count + 7) / 8;
+                return arr;
+            }
+
+            ArrayNode* arr = new ArrayNode(ArrayNode::Numbers);
+            std::vector<double>& values = arr->numbers();
+            try
+            {
+                if (tag == BinaryIntegers)
+                {
+                    need(count);
+                    values.resize(count);
+                    for (uint64_t i = 0; i < count; ++i)
+                        values[i] = (double) zigzag();
+                }
+                else if (tag == BinaryDoubles)
+                {
+                    need(count * sizeof(double));
+                    values.resize(count);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                    for (uint64_t i = 0; i < count; ++i)
+                        values[i] = raw<double>();
+#else
+                    if (count)
+                        std::memcpy(&values[0], m_ptr, count * sizeof(double));
+                    m_ptr += count * sizeof(double);
+#endif
+                }
+                else
+                {
+                    need(count * sizeof(float));
+                    arr->setSingle(true);
+                    values.resize(count);
+                    for (uint64_t i = 0; i < count; ++i)
+                        values[i] = raw<float>();
+                }
+            }
+            catch (...)
+            {
+                delete arr;
+                throw;
+            }
+            return arr;
+        }
+
+        void need(uint64_t size)
+        {
+            if (size > (uint64_t) (m_end - m_ptr))
+                throw std::logic_error("json::decodeBinary: truncated data");
+        }
+
+        unsigned char byte()
+        {
+            need(1);
+            return *m_ptr++;
+        }
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                unsigned char b = byte();
+                value |= (uint64_t) (b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return value;
+            }
+            throw std::logic_error("json::decodeBinary: bad varint");
+        }
+
+        int64_t zigzag()
+        {
+            uint64_t value = varint();
+            return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+        }
+
+        std::string string()
+        {
+            uint64_t size = varint();
+            need(size);
+            std::string str((char const*) m_ptr, size);
+            m_ptr += size;
+            return str;
+        }
+
+        template <typename T>
+        T raw()
+        {
+            T value;
+            need(sizeof(T));
+            std::memcpy(&value, m_ptr, sizeof(T));
+            m_ptr += sizeof(T);
+            swapBytes(value);
+            return value;
+        }
+
+    private:
+        unsigned char const* m_ptr;
+        unsigned char const* m_end;
+        std::size_t m_depth;
+    };
+}
+
+namespace lconf { namespace json
+{
+    void encodeBinary(Node const* node, Buffer& out)
+    {
+        out.write(magic, 4);
+        Encoder encoder(out);
+        encoder.node(node);
+    }
+
+    Node* decodeBinary(char const* data, std::size_t size)
+    {
+        Decoder decoder(data, size);
+        decoder.header();
+        Node* node = decoder.node();
+        try
+        {
+            decoder.finish();
+        }
+        catch (...)
+        {
+            delete node;
+            throw;
+        }
+        return node;
+    }
+
+    Node* decodeBinary(std::istream& in)
+    {
+        std::string data;
+        char chunk[1 << 16];
+        while (in.read(chunk, sizeof(chunk)) || in.gcount())
+            data.append(chunk, in.gcount());
+        return decodeBinary(data.data(), data.size());
+    }
+} }
@@ -0,0 +1,157 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_buffer.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    //! Precomputed indentation.
+    std::string const spaces(256, ' ');
+
+    //! Tell if a character must be escaped in a JSON string.
+    inline bool needsEscape(unsigned char c)
+    { return c < 0x20 || c == '"' || c == '\\'; }
+
+    //! Find the first character of data[0, size) needing an escape,
+    //!   or size if there is none.
+    std::size_t findEscape(char const* data, std::size_t size)
+    {
+        std::size_t i = 0;
+
+#if defined(__AVX2__)
+        __m256i const quote = _mm256_set1_epi8('"');
+        __m256i const backslash = _mm256_set1_epi8('\\');
+        __m256i const control = _mm256_set1_epi8(0x1F);
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i in = _mm256_loadu_si256((__m256i const*) (data + i));
+            // c <= 0x1F as unsigned bytes <=> max(c, 0x1F) == 0x1F
+            __m256i mask = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(in, quote), _mm256_cmpeq_epi8(in, backslash)),
+                _mm256_cmpeq_epi8(_mm256_max_epu8(in, control), control));
+            unsigned int bits = _mm256_movemask_epi8(mask);
+            if (bits)
+                return i + __builtin_ctz(bits);
+        }
+#elif defined(__SSE2__)
+        __m128i const quote = _mm_set1_epi8('"');
+        __m128i const backslash = _mm_set1_epi8('\\');
+        __m128i const control = _mm_set1_epi8(0x1F);
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i in = _mm_loadu_si128((__m128i const*) (data + i));
+            // c <= 0x1F as unsigned bytes <=> max(c, 0x1F) == 0x1F
+            __m128i mask = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(in, quote), _mm_cmpeq_epi8(in, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(in, control), control));
+            unsigned int bits = _mm_movemask_epi8(mask);
+            if (bits)
+                return i + __builtin_ctz(bits);
+        }
+#endif
+
+        for (; i < size; ++i)
+        {
+            if (needsEscape(data[i]))
+                break;
+        }
+        return i;
+    }
+}
+
+Buffer::Buffer() :
+    m_out(0)
+{}
+
+Buffer::Buffer(std::ostream& out) :
+    m_out(&out)
+{
+    m_data.reserve(2 * ChunkSize);
+}
+
+Buffer::~Buffer()
+{}
+
+void Buffer::indent(int level)
+{
+    while (level > 0)
+    {
+        int count = std::min<int>(level, spaces.size());
+        write(spaces.data(), count);
+        level -= count;
+    }
+}
+
+void Buffer::escaped(char const* data, std::size_t size)
+{
+    static char const digits[] = "0123456789abcdef";
+
+    std::size_t i = 0;
+    while (i < size)
+    {
+        std::size_t end = i + findEscape(data + i, size - i);
+        if (end > i)
+            write(data + i, end - i);
+        if (end == size)
+            break;
+
+        unsigned char c = data[end];
+        switch (c)
+        {
+            case '"':  write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\t': write("\\t", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\b': write("\\b", 2); break;
+            case '\f': write("\\f", 2); break;
+            default:
+            {
+                char str[6] = { '\\', 'u', '0', '0', digits[c >> 4], digits[c & 0xF] };
+                write(str, 6);
+                break;
+            }
+        }
+        i = end + 1;
+    }
+}
+
+void Buffer::flush()
+{
+    if (m_out && !m_data.empty())
+    {
+        m_out->write(m_data.data(), m_data.size());
+        m_data.clear();
+    }
+}
+
+std::string const& Buffer::str() const
+{ return m_data; }
+
+std::string& Buffer::str()
+{ return m_data; }
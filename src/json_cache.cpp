@@ -0,0 +1,213 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_cache.h"
+#include "lconf/json_binary.h"
+#include "lconf/json_lexer.h"
+#include "lconf/json_parser.h"
+#include "lconf/json_file.h"
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    std::string cacheDir;
+    bool enabled = false;
+
+    //! Cache entries are the magic number, the number of included files,
+    //!   a (path size, path, fingerprint) record for each of them, and
+    //!   the binary form of the tree (in host byte order, as the cache
+    //!   is meant to stay local).
+    char const magic[4] = { 'L', 'C', 'C', '1' };
+
+    bool readFile(std::string const& file, std::string& data)
+    {
+        std::ifstream fs(file, std::ios::in | std::ios::binary);
+        if (!fs)
+            return false;
+
+        std::ostringstream ss;
+        ss << fs.rdbuf();
+        data = ss.str();
+        return true;
+    }
+
+    std::string entryPath(uint64_t hash)
+    {
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+        return cacheDir + "/" + name + ".lcc";
+    }
+
+    template <typename T>
+    bool readRaw(char const*& ptr, char const* end, T& value)
+    {
+        if ((std::size_t) (end - ptr) < sizeof(T))
+            return false;
+        std::memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return true;
+    }
+
+    //! Load a cache entry, returning 0 if it is missing, invalid,
+    //!   or if one of the included files changed.
+    Node* load(std::string const& entry)
+    {
+        std::string data;
+        if (!readFile(entry, data) || data.size() < 4 || std::memcmp(data.data(), magic, 4))
+            return 0;
+
+        char const* ptr = data.data() + 4;
+        char const* end = data.data() + data.size();
+
+        uint32_t count;
+        if (!readRaw(ptr, end, count))
+            return 0;
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t size;
+            uint64_t hash;
+            if (!readRaw(ptr, end, size) || (std::size_t) (end - ptr) < size)
+                return 0;
+            std::string path(ptr, size);
+            ptr += size;
+            if (!readRaw(ptr, end, hash))
+                return 0;
+
+            std::string contents;
+            if (!readFile(path, contents) || fingerprint(contents.data(), contents.size()) != hash)
+                return 0;
+        }
+
+        try
+        {
+            return decodeBinary(ptr, end - ptr);
+        }
+        catch (std::logic_error const&)
+        {
+            return 0;
+        }
+    }
+
+    template <typename T>
+    void writeRaw(Buffer& out, T value)
+    { out.write((char const*) &value, sizeof(T)); }
+
+    //! Write a cache entry, atomically (concurrent processes may
+    //!   compile the same file at the same time).
+    void store(std::string const& entry, Node const* node, std::vector<std::string> const& includes)
+    {
+        Buffer out;
+        out.write(magic, 4);
+        writeRaw<uint32_t>(out, includes.size());
+        for (std::size_t i = 0; i < includes.size(); ++i)
+        {
+            std::string contents;
+            if (!readFile(includes[i], contents))
+                return;
+
+            writeRaw<uint32_t>(out, includes[i].size());
+            out.write(includes[i]);
+            writeRaw<uint64_t>(out, fingerprint(contents.data(), contents.size()));
+        }
+        encodeBinary(node, out);
+
+        try
+        {
+            writeFile(entry, out.str().data(), out.size(), Atomic);
+        }
+        catch (std::logic_error const&)
+        {}
+    }
+}
+
+namespace lconf { namespace json
+{
+    void enableCache(std::string const& dir)
+    {
+        // The directory may already exist
+        ::mkdir(dir.c_str(), 0755);
+
+        cacheDir = dir;
+        enabled = true;
+    }
+
+    void disableCache()
+    {
+        enabled = false;
+    }
+
+    bool cacheEnabled()
+    {
+        return enabled;
+    }
+
+    Node* parseCached(std::string const& file)
+    {
+        Status status;
+        Node* node = parseCached(file, status);
+        if (!node)
+            status.raise();
+        return node;
+    }
+
+    Node* parseCached(std::string const& file, Status& status)
+    {
+        std::string text;
+        if (!readFile(file, text))
+        {
+            status.fail(Status::IoError, "json::parse: unable to open \"" + file + "\"");
+            return 0;
+        }
+
+        std::string entry = entryPath(fingerprint(text.data(), text.size()));
+        if (Node* node = load(entry))
+        {
+            status.clear();
+            return node;
+        }
+
+        Lexer lexer(text.data(), text.size());
+        Parser parser(lexer);
+        Node* node = parser.parse(status);
+        if (!node)
+            return 0;
+
+        store(entry, node, parser.includes());
+        return node;
+    }
+
+    uint64_t fingerprint(char const* data, std::size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= (unsigned char) data[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+} }
@@ -0,0 +1,445 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_codec.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The SSSE3 base64 encoder is compiled even if the build does not enable
+//   SSSE3, and only used if the processor supports it
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define LCONF_BASE64_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    //! Hexadecimal digits of each byte value.
+    struct HexTable
+    {
+        HexTable()
+        {
+            static char const digits[] = "0123456789abcdef";
+
+            for (int i = 0; i < 256; ++i)
+            {
+                encode[2*i] = digits[i >> 4];
+                encode[2*i + 1] = digits[i & 0xF];
+                decode[i] = -1;
+            }
+
+            for (int i = 0; i < 10; ++i)
+                decode['0' + i] = i;
+            for (int i = 0; i < 6; ++i)
+            {
+                decode['a' + i] = 10 + i;
+                decode['A' + i] = 10 + i;
+            }
+        }
+
+        char encode[512];
+        int8_t decode[256];
+    };
+
+    HexTable const table;
+
+    //! Base64 alphabets and their reverse lookup tables.
+    struct Base64Table
+    {
+        Base64Table(char const* alphabet) :
+            encode(alphabet)
+        {
+            for (int i = 0; i < 256; ++i)
+                decode[i] = -1;
+            for (int i = 0; i < 64; ++i)
+                decode[static_cast<uint8_t>(alphabet[i])] = i;
+        }
+
+        char const* encode;
+        int8_t decode[256];
+    };
+
+    Base64Table const base64_table("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+    Base64Table const base64url_table("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_");
+
+    //! Strip the base64 padding at the end of str.
+    std::size_t base64Length(std::string const& str)
+    {
+        std::size_t length = str.size();
+        for (int i = 0; i < 2 && length && str[length - 1] == '='; ++i)
+            --length;
+        return length;
+    }
+
+#if defined(__SSE2__)
+    //! Convert 16 nibbles to their lowercase hexadecimal digits.
+    inline __m128i toHexDigits(__m128i nibbles)
+    {
+        __m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+        __m128i digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+        return _mm_add_epi8(digits, _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+    }
+
+    //! Convert 16 hexadecimal digits to nibbles, clearing
+    //!   valid's bytes for invalid characters.
+    inline __m128i fromHexDigits(__m128i chars, __m128i& valid)
+    {
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                         _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), chars));
+        __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+        __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                          _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+
+        __m128i digits = _mm_and_si128(is_digit, _mm_sub_epi8(chars, _mm_set1_epi8('0')));
+        __m128i letters = _mm_and_si128(is_letter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)));
+
+        valid = _mm_and_si128(valid, _mm_or_si128(is_digit, is_letter));
+        return _mm_or_si128(digits, letters);
+    }
+
+    //! Assemble pairs of nibbles (most significant first) into
+    //!   the low byte of each 16-bit lane.
+    inline __m128i fromNibblePairs(__m128i nibbles)
+    {
+        __m128i high = _mm_and_si128(_mm_slli_epi16(nibbles, 4), _mm_set1_epi16(0x00F0));
+        __m128i low = _mm_srli_epi16(nibbles, 8);
+        return _mm_or_si128(high, low);
+    }
+#endif
+
+#if defined(__SSE2__)
+    //! Convert 16 base64 characters to their 6-bit values, clearing
+    //!   valid's bytes for characters outside of the alphabet.
+    inline __m128i fromBase64(__m128i chars, __m128i& valid, bool url)
+    {
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('A' - 1)),
+                                      _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), chars));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('a' - 1)),
+                                      _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), chars));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), chars));
+        __m128i plus = _mm_cmpeq_epi8(chars, _mm_set1_epi8(url ? '-' : '+'));
+        __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8(url ? '_' : '/'));
+
+        // Offset of each character's range
+        __m128i offsets = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                         _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+            _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                         _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - (url ? '-' : '+'))),
+                                      _mm_and_si128(slash, _mm_set1_epi8(63 - (url ? '_' : '/'))))));
+
+        valid = _mm_and_si128(valid, _mm_or_si128(_mm_or_si128(upper, lower),
+                                                  _mm_or_si128(digit, _mm_or_si128(plus, slash))));
+        return _mm_add_epi8(chars, offsets);
+    }
+
+    //! Assemble 16 6-bit values into the 12 bytes they encode,
+    //!   in the low bytes of the result.
+    inline __m128i fromBase64Values(__m128i values)
+    {
+        // One 24-bit group per 32-bit lane, first value most significant
+        __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 6),
+                                     _mm_srli_epi16(values, 8));
+        __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+        // Swap the bytes of each lane, so that the groups are big-endian
+        groups = _mm_shufflehi_epi16(_mm_shufflelo_epi16(groups, 0xB1), 0xB1);
+        groups = _mm_or_si128(_mm_slli_epi16(groups, 8), _mm_srli_epi16(groups, 8));
+
+        // Drop the leading zero byte of each lane, in each 64-bit half,
+        //   and then the two zero bytes between both halves
+        __m128i halves = _mm_or_si128(_mm_and_si128(_mm_srli_epi64(groups, 8), _mm_set1_epi64x(0xFFFFFF)),
+                                      _mm_slli_epi64(_mm_srli_epi64(groups, 40), 24));
+        return _mm_or_si128(_mm_and_si128(halves, _mm_set_epi32(0, 0, -1, -1)),
+                            _mm_srli_si128(_mm_and_si128(halves, _mm_set_epi32(-1, -1, 0, 0)), 2));
+    }
+#endif
+
+#if defined(LCONF_BASE64_SSSE3)
+    //! Tell if the SSSE3 encoder can be used.
+    bool hasSsse3()
+    {
+#if defined(__SSSE3__)
+        return true;
+#else
+        static bool const supported = __builtin_cpu_supports("ssse3");
+        return supported;
+#endif
+    }
+
+    //! Encode 12 bytes (in the low bytes of the input) into
+    //!   16 base64 characters.
+    LCONF_BASE64_SSSE3 inline __m128i toBase64(__m128i input, bool url)
+    {
+        // Gather each 3-byte group into a 32-bit lane, as two
+        //   big-endian 16-bit words : [b, a, c, b]
+        __m128i in = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        // Extract the four 6-bit indices of each lane
+        __m128i first = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        __m128i second = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(first, second);
+
+        // Reduce the indices to the alphabet ranges (0 for [26, 51],
+        //   1 to 10 for the digits, 11 and 12 for the last two
+        //   characters and 13 for [0, 25]), and add each range's offset
+        __m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        ranges = _mm_or_si128(ranges, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+        __m128i offsets = url ?
+            _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0) :
+            _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+        return _mm_add_epi8(_mm_shuffle_epi8(offsets, ranges), indices);
+    }
+
+    //! Encode the leading 12-byte blocks of data (loading 16 bytes
+    //!   for each of them), returning the number of bytes encoded.
+    LCONF_BASE64_SSSE3 std::size_t toBase64Blocks(uint8_t const* data, std::size_t size, char* out, bool url)
+    {
+        std::size_t i = 0;
+        for (; i + 16 <= size; i += 12, out += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), toBase64(bytes, url));
+        }
+        return i;
+    }
+#endif
+}
+
+std::string json::encode(Encoding encoding, void const* data, std::size_t size)
+{
+    if (encoding == Hex)
+        return hexEncode(data, size);
+    return base64Encode(data, size, encoding == Base64Url);
+}
+
+bool json::decodedSize(Encoding encoding, std::string const& str, std::size_t& size)
+{
+    if (encoding == Hex)
+    {
+        size = str.size() / 2;
+        return str.size() % 2 == 0;
+    }
+
+    std::size_t length = base64Length(str);
+    if (length % 4 == 1)
+        return false;
+    // Padding is mandatory for plain base64
+    if (encoding == Base64 && str.size() % 4 != 0)
+        return false;
+
+    size = (3 * length) / 4;
+    return true;
+}
+
+bool json::decode(Encoding encoding, std::string const& str, void* out)
+{
+    uint8_t* bytes = static_cast<uint8_t*>(out);
+
+    if (encoding == Hex)
+        return hexDecode(str.data(), str.size() / 2, bytes);
+    return base64Decode(str.data(), base64Length(str), bytes, encoding == Base64Url);
+}
+
+std::string json::hexEncode(void const* data, std::size_t size)
+{
+    std::string str(2*size, '\0');
+    if (size)
+        hexEncode(static_cast<uint8_t const*>(data), size, &str[0]);
+    return str;
+}
+
+void json::hexEncode(uint8_t const* data, std::size_t size, char* out)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    // 16 bytes at a time
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+        __m128i high = toHexDigits(_mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0xF)));
+        __m128i low = toHexDigits(_mm_and_si128(bytes, _mm_set1_epi8(0xF)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2*i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2*i + 16), _mm_unpackhi_epi8(high, low));
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        char const* digits = table.encode + 2*data[i];
+        out[2*i] = digits[0];
+        out[2*i + 1] = digits[1];
+    }
+}
+
+bool json::hexDecode(char const* in, std::size_t size, uint8_t* out)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    // 32 digits at a time
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i valid = _mm_set1_epi8(-1);
+        __m128i first = fromHexDigits(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + 2*i)), valid);
+        __m128i second = fromHexDigits(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + 2*i + 16)), valid);
+
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            return false;
+
+        __m128i bytes = _mm_packus_epi16(fromNibblePairs(first), fromNibblePairs(second));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        int high = table.decode[static_cast<uint8_t>(in[2*i])];
+        int low = table.decode[static_cast<uint8_t>(in[2*i + 1])];
+        if ((high | low) < 0)
+            return false;
+
+        out[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+
+    return true;
+}
+
+std::string json::base64Encode(void const* data, std::size_t size, bool url)
+{
+    std::string str(4 * ((size + 2) / 3), '\0');
+    if (size)
+        str.resize(base64Encode(static_cast<uint8_t const*>(data), size, &str[0], url));
+    return str;
+}
+
+std::size_t json::base64Encode(uint8_t const* data, std::size_t size, char* out, bool url)
+{
+    char const* alphabet = url ? base64url_table.encode : base64_table.encode;
+    std::size_t i = 0;
+    char* start = out;
+
+#if defined(LCONF_BASE64_SSSE3)
+    // 12 bytes at a time
+    if (hasSsse3())
+    {
+        i = toBase64Blocks(data, size, out, url);
+        out += 4 * (i / 3);
+    }
+#endif
+
+    for (; i + 3 <= size; i += 3, out += 4)
+    {
+        uint32_t group = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out[0] = alphabet[group >> 18];
+        out[1] = alphabet[(group >> 12) & 0x3F];
+        out[2] = alphabet[(group >> 6) & 0x3F];
+        out[3] = alphabet[group & 0x3F];
+    }
+
+    // Last partial group
+    if (i < size)
+    {
+        uint32_t group = data[i] << 16;
+        if (i + 1 < size)
+            group |= data[i + 1] << 8;
+
+        *out++ = alphabet[group >> 18];
+        *out++ = alphabet[(group >> 12) & 0x3F];
+        if (i + 1 < size)
+            *out++ = alphabet[(group >> 6) & 0x3F];
+        else if (!url)
+            *out++ = '=';
+        if (!url)
+            *out++ = '=';
+    }
+
+    return out - start;
+}
+
+bool json::base64Decode(char const* in, std::size_t length, uint8_t* out, bool url)
+{
+    int8_t const* table = url ? base64url_table.decode : base64_table.decode;
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    // 16 characters at a time
+    for (; i + 16 <= length; i += 16, out += 12)
+    {
+        __m128i valid = _mm_set1_epi8(-1);
+        __m128i values = fromBase64(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i)), valid, url);
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            return false;
+
+        // Store the 12 bytes as 8 + 4 of them
+        __m128i bytes = fromBase64Values(values);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), bytes);
+        std::memcpy(out + 8, &last, 4);
+    }
+#endif
+
+    for (; i + 4 <= length; i += 4, out += 3)
+    {
+        int32_t a = table[static_cast<uint8_t>(in[i])];
+        int32_t b = table[static_cast<uint8_t>(in[i + 1])];
+        int32_t c = table[static_cast<uint8_t>(in[i + 2])];
+        int32_t d = table[static_cast<uint8_t>(in[i + 3])];
+        if ((a | b | c | d) < 0)
+            return false;
+
+        uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = static_cast<uint8_t>(group >> 16);
+        out[1] = static_cast<uint8_t>(group >> 8);
+        out[2] = static_cast<uint8_t>(group);
+    }
+
+    // Last partial group (2 or 3 characters)
+    std::size_t rest = length - i;
+    if (rest == 1)
+        return false;
+    if (rest)
+    {
+        int32_t a = table[static_cast<uint8_t>(in[i])];
+        int32_t b = table[static_cast<uint8_t>(in[i + 1])];
+        int32_t c = rest == 3 ? table[static_cast<uint8_t>(in[i + 2])] : 0;
+        if ((a | b | c) < 0)
+            return false;
+
+        uint32_t group = (a << 18) | (b << 12) | (c << 6);
+        out[0] = static_cast<uint8_t>(group >> 16);
+        if (rest == 3)
+            out[1] = static_cast<uint8_t>(group >> 8);
+    }
+
+    return true;
+}
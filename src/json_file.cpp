@@ -0,0 +1,131 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_file.h"
+#include <stdexcept>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    //! Distinguishes the temporary files of concurrent writes.
+    unsigned long counter = 0;
+
+    void fail(std::string const& file, std::string const& what)
+    {
+        throw std::logic_error("json::writeFile: " + what + " \"" + file + "\": " + std::strerror(errno));
+    }
+
+    //! Write everything, resuming after partial writes and signals.
+    bool writeAll(int fd, char const* data, std::size_t size)
+    {
+        while (size)
+        {
+            ssize_t count = ::write(fd, data, size);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    std::string directoryOf(std::string const& file)
+    {
+        std::size_t slash = file.rfind('/');
+        if (slash == std::string::npos)
+            return ".";
+        if (slash == 0)
+            return "/";
+        return file.substr(0, slash);
+    }
+}
+
+namespace lconf { namespace json
+{
+    void writeFile(std::string const& file, char const* data, std::size_t size, int flags)
+    {
+        if (!(flags & Atomic))
+        {
+            int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (fd < 0)
+                fail(file, "unable to open");
+
+            bool ok = writeAll(fd, data, size) && (!(flags & Sync) || !::fdatasync(fd));
+            ok = !::close(fd) && ok;
+            if (!ok)
+                fail(file, "unable to write");
+            return;
+        }
+
+        std::ostringstream ss;
+        ss << file << "." << ::getpid() << "." << __sync_fetch_and_add(&counter, 1) << ".tmp";
+        std::string tmp = ss.str();
+
+        // The permissions are the ones of a newly created file (or the
+        //   ones of the replaced file, if any)
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd < 0)
+            fail(tmp, "unable to create");
+
+        struct stat st;
+        if (!::stat(file.c_str(), &st))
+            ::fchmod(fd, st.st_mode & 07777);
+
+        bool ok = writeAll(fd, data, size) && (!(flags & Sync) || !::fdatasync(fd));
+        ok = !::close(fd) && ok;
+        if (!ok)
+        {
+            int error = errno;
+            ::unlink(tmp.c_str());
+            errno = error;
+            fail(tmp, "unable to write");
+        }
+
+        if (::rename(tmp.c_str(), file.c_str()))
+        {
+            int error = errno;
+            ::unlink(tmp.c_str());
+            errno = error;
+            fail(file, "unable to replace");
+        }
+
+        // Make the rename itself durable
+        if (flags & Sync)
+        {
+            int dir = ::open(directoryOf(file).c_str(), O_RDONLY);
+            if (dir >= 0)
+            {
+                ::fsync(dir);
+                ::close(dir);
+            }
+        }
+    }
+} }
@@ -0,0 +1,82 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_incremental.h"
+#include <stdexcept>
+#include <fstream>
+
+using namespace lconf;
+using namespace json;
+
+Incremental::Incremental(Template const& tpl, bool indent) :
+    m_tpl(tpl),
+    m_indent(indent)
+{}
+
+Incremental::~Incremental()
+{}
+
+std::string const& Incremental::synthetize()
+{
+    Buffer buffer;
+    Writer writer(buffer, m_indent);
+
+    try
+    {
+        m_tpl.write(writer, m_root, m_output);
+    }
+    catch (...)
+    {
+        // Fragments may be half updated
+        reset();
+        throw;
+    }
+
+    m_output.swap(buffer.str());
+    return m_output;
+}
+
+void Incremental::synthetize(std::ostream& out)
+{
+    std::string const& output = synthetize();
+    out.write(output.data(), output.size());
+}
+
+void Incremental::synthetize(std::string const& file, int flags)
+{
+    if (flags)
+    {
+        std::string const& output = synthetize();
+        writeFile(file, output.data(), output.size(), flags);
+        return;
+    }
+
+    std::ofstream fs(file, std::ios::out);
+    if (!fs)
+        throw std::logic_error("json::Incremental::synthetize: unable to open\"" + file + "\"");
+    synthetize(fs);
+}
+
+std::string const& Incremental::str() const
+{ return m_output; }
+
+void Incremental::reset()
+{
+    m_root = Fragment();
+    m_output.clear();
+}
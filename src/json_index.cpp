@@ -0,0 +1,104 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_index.h"
+
+using namespace lconf;
+using namespace json;
+
+Index::Index(Node* root) :
+    m_root(root),
+    m_generation(0),
+    m_built(false)
+{}
+
+Node* Index::find(std::string const& pointer) const
+{
+    M_check();
+    std::unordered_map<std::string, Node*>::const_iterator it = m_nodes.find(pointer);
+    return it == m_nodes.end() ? 0 : it->second;
+}
+
+Node* Index::find(Path const& path) const
+{
+    if (path.isPointer())
+        return find(path.str());
+    return path.find(m_root);
+}
+
+bool Index::exists(std::string const& pointer) const
+{
+    return find(pointer) != 0;
+}
+
+std::size_t Index::size() const
+{
+    M_check();
+    return m_nodes.size();
+}
+
+Node* Index::root() const
+{
+    return m_root;
+}
+
+void Index::rebuild() const
+{
+    m_nodes.clear();
+    m_root->track();
+
+    std::string pointer;
+    M_index(m_root, pointer);
+
+    m_generation = m_root->generation();
+    m_built = true;
+}
+
+void Index::M_check() const
+{
+    if (!m_built || m_generation != m_root->generation())
+        rebuild();
+}
+
+void Index::M_index(Node* node, std::string& pointer) const
+{
+    m_nodes[pointer] = node;
+    std::size_t size = pointer.size();
+
+    if (ObjectNode const* obj = node->downcast<ObjectNode>())
+    {
+        std::map<std::string, Node*> const& impl = obj->impl();
+        for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+        {
+            pointer += '/';
+            pointer += Path::escape(it->first);
+            M_index(it->second, pointer);
+            pointer.resize(size);
+        }
+    }
+    else if (ArrayNode const* arr = node->downcast<ArrayNode>())
+    {
+        for (std::size_t i = 0; i < arr->size(); ++i)
+        {
+            pointer += '/';
+            pointer += std::to_string(i);
+            M_index(arr->at(i), pointer);
+            pointer.resize(size);
+        }
+    }
+}
@@ -0,0 +1,340 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_layers.h"
+#include <stdexcept>
+#include <algorithm>
+
+using namespace lconf;
+using namespace json;
+
+// Overlay
+
+Overlay::Overlay() :
+    m_layers(0)
+{}
+
+Overlay::Overlay(Layers const* layers, std::vector<std::string> const& path) :
+    m_layers(layers),
+    m_path(path)
+{}
+
+bool Overlay::exists() const
+{
+    return !m_nodes.empty();
+}
+
+Node::Type Overlay::type() const
+{
+    return m_nodes.empty() ? Node::Null : m_nodes.back()->type();
+}
+
+Node const* Overlay::node() const
+{
+    return m_nodes.empty() ? 0 : m_nodes.back();
+}
+
+std::vector<std::string> Overlay::keys() const
+{
+    std::vector<std::string> keys;
+    if (type() != Node::Object)
+        return keys;
+
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        std::map<std::string, Node*> const& impl = ((ObjectNode const*) m_nodes[i])->impl();
+        for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+            keys.push_back(it->first);
+    }
+
+    if (m_nodes.size() > 1)
+    {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+    return keys;
+}
+
+bool Overlay::exists(std::string const& key) const
+{
+    if (type() != Node::Object)
+        return false;
+
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        std::map<std::string, Node*> const& impl = ((ObjectNode const*) m_nodes[i])->impl();
+        if (impl.find(key) != impl.end())
+            return true;
+    }
+    return false;
+}
+
+Overlay Overlay::get(std::string const& key) const
+{
+    std::vector<Node const*> candidates;
+    if (type() == Node::Object)
+    {
+        for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            std::map<std::string, Node*> const& impl = ((ObjectNode const*) m_nodes[i])->impl();
+            std::map<std::string, Node*>::const_iterator it = impl.find(key);
+            if (it != impl.end())
+                candidates.push_back(it->second);
+        }
+    }
+
+    if (candidates.empty())
+        throw std::domain_error("json::Overlay::get: no such key \"" + key + "\"");
+
+    Overlay value(m_layers, m_path);
+    value.m_path.push_back(key);
+    value.M_resolve(candidates);
+    return value;
+}
+
+std::size_t Overlay::size() const
+{
+    if (type() == Node::Object)
+        return m_nodes.size() == 1 ? ((ObjectNode const*) m_nodes[0])->impl().size() : keys().size();
+    if (type() != Node::Array)
+        return 0;
+
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        size += ((ArrayNode const*) m_nodes[i])->size();
+    return size;
+}
+
+Overlay Overlay::at(std::size_t i) const
+{
+    if (type() == Node::Array)
+    {
+        std::size_t index = i;
+        for (std::size_t j = 0; j < m_nodes.size(); ++j)
+        {
+            ArrayNode const* arr = (ArrayNode const*) m_nodes[j];
+            if (index < arr->size())
+            {
+                Overlay value(m_layers, m_path);
+                value.m_path.push_back(std::to_string(i));
+                value.M_resolve(std::vector<Node const*>(1, arr->at(index)));
+                return value;
+            }
+            index -= arr->size();
+        }
+    }
+
+    throw std::domain_error("json::Overlay::at: index out of bounds");
+}
+
+bool Overlay::find(Path const& path, Overlay& value) const
+{
+    if (!path.isPointer())
+        throw std::logic_error("json::Overlay::find: \"" + path.str() + "\" is not a plain pointer");
+
+    Overlay current = *this;
+    for (std::size_t i = 0; i < path.size(); ++i)
+    {
+        if (current.type() == Node::Object && current.exists(path.key(i)))
+            current = current.get(path.key(i));
+        else if (current.type() == Node::Array && path.isIndex(i) && path.index(i) < current.size())
+            current = current.at(path.index(i));
+        else
+            return false;
+    }
+
+    if (!current.exists())
+        return false;
+
+    value = current;
+    return true;
+}
+
+Node* Overlay::materialize() const
+{
+    if (m_nodes.empty())
+        throw std::domain_error("json::Overlay::materialize: no such value");
+
+    // Values coming from a single layer are copied as is
+    if (m_nodes.size() == 1)
+        return m_nodes[0]->clone();
+
+    if (type() == Node::Object)
+    {
+        std::vector<std::string> keys = this->keys();
+        ObjectNode* obj = new ObjectNode();
+        try
+        {
+            std::map<std::string, Node*>& impl = obj->impl();
+            for (std::size_t i = 0; i < keys.size(); ++i)
+                impl.insert(impl.end(), std::make_pair(keys[i], get(keys[i]).materialize()));
+        }
+        catch (...)
+        {
+            delete obj;
+            throw;
+        }
+        return obj;
+    }
+
+    // Appended arrays, kept packed if they all are
+    bool numbers = true;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        numbers = numbers && ((ArrayNode const*) m_nodes[i])->storage() == ArrayNode::Numbers &&
+            ((ArrayNode const*) m_nodes[i])->isSingle() == ((ArrayNode const*) m_nodes[0])->isSingle();
+
+    if (numbers)
+    {
+        ArrayNode* arr = new ArrayNode(ArrayNode::Numbers);
+        arr->setSingle(((ArrayNode const*) m_nodes[0])->isSingle());
+        std::vector<double>& values = arr->numbers();
+        for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            std::vector<double> const& layer = ((ArrayNode const*) m_nodes[i])->numbers();
+            values.insert(values.end(), layer.begin(), layer.end());
+        }
+        return arr;
+    }
+
+    ArrayNode* arr = new ArrayNode();
+    try
+    {
+        std::vector<Node*>& impl = arr->impl();
+        for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            ArrayNode const* layer = (ArrayNode const*) m_nodes[i];
+            for (std::size_t j = 0; j < layer->size(); ++j)
+                impl.push_back(layer->at(j)->clone());
+        }
+    }
+    catch (...)
+    {
+        delete arr;
+        throw;
+    }
+    return arr;
+}
+
+//! Keep the candidate nodes (from the lowest layer up) that
+//!   contribute to the value, according to its strategy.
+void Overlay::M_resolve(std::vector<Node const*> const& candidates)
+{
+    m_nodes.clear();
+    if (candidates.empty())
+        return;
+
+    Node const* top = candidates.back();
+    Layers::Strategy strategy = m_layers->strategy(m_path);
+    if (strategy == Layers::Replace ||
+        (strategy == Layers::Merge && top->type() != Node::Object) ||
+        (strategy == Layers::Append && top->type() != Node::Array))
+    {
+        m_nodes.push_back(top);
+        return;
+    }
+
+    // Lower values of another type are replaced by upper ones
+    std::size_t first = candidates.size() - 1;
+    while (first > 0 && candidates[first - 1]->type() == top->type())
+        --first;
+    m_nodes.assign(candidates.begin() + first, candidates.end());
+}
+
+// Layers
+
+Layers::Layers()
+{}
+
+Layers::Layers(Layers const& other) :
+    m_layers(other.m_layers),
+    m_rules(other.m_rules)
+{
+    for (std::size_t i = 0; i < m_layers.size(); ++i)
+        m_layers[i]->share();
+}
+
+Layers& Layers::operator=(Layers const& other)
+{
+    Layers copy(other);
+    m_layers.swap(copy.m_layers);
+    m_rules.swap(copy.m_rules);
+    return *this;
+}
+
+Layers::~Layers()
+{
+    for (std::size_t i = 0; i < m_layers.size(); ++i)
+        Node::release(m_layers[i]);
+}
+
+Layers& Layers::push(Node* layer)
+{
+    m_layers.push_back(layer->share());
+    return *this;
+}
+
+std::size_t Layers::size() const
+{
+    return m_layers.size();
+}
+
+Layers& Layers::strategy(std::string const& path, Strategy strategy)
+{
+    Rule rule;
+    rule.path = Path(path, false);
+    rule.strategy = strategy;
+    m_rules.push_back(rule);
+    return *this;
+}
+
+Layers::Strategy Layers::strategy(std::vector<std::string> const& path) const
+{
+    // Later rules take precedence
+    for (std::size_t i = m_rules.size(); i > 0; --i)
+    {
+        Path const& rule = m_rules[i - 1].path;
+        if (rule.size() != path.size())
+            continue;
+
+        bool matches = true;
+        for (std::size_t j = 0; matches && j < path.size(); ++j)
+            matches = rule.key(j) == "*" || rule.key(j) == path[j];
+        if (matches)
+            return m_rules[i - 1].strategy;
+    }
+    return Merge;
+}
+
+Overlay Layers::root() const
+{
+    Overlay root(this, std::vector<std::string>());
+    root.M_resolve(std::vector<Node const*>(m_layers.begin(), m_layers.end()));
+    return root;
+}
+
+bool Layers::find(Path const& path, Overlay& value) const
+{
+    return root().find(path, value);
+}
+
+Node* Layers::merge() const
+{
+    if (m_layers.empty())
+        return new ObjectNode();
+    return root().materialize();
+}
@@ -18,12 +18,35 @@
 
 #include "lconf/json_lexer.h"
 #include <fstream>
+#include <algorithm>
+#include <cctype>
 
 using namespace lconf;
 using namespace json;
 
+namespace
+{
+    //! Value of m_nextChar when the next character of a stream
+    //!   has not been peeked yet (see M_eat()).
+    int const pendingChar = -2;
+}
+
 Lexer::Lexer(std::istream& in) :
-    m_in(in)
+    m_in(&in),
+    m_begin(0),
+    m_end(0),
+    m_offset(0)
+{
+    // Line starts are recorded while reading
+    m_lines.push_back(0);
+    M_init();
+}
+
+Lexer::Lexer(char const* data, std::size_t size) :
+    m_in(0),
+    m_begin(data),
+    m_end(data + size),
+    m_offset(0)
 {
     M_init();
 }
@@ -34,46 +57,165 @@ Lexer::~Lexer()
 
 Token Lexer::get()
 {
-    Token tok = m_nextToken;
-    m_nextToken = M_getToken();
-    return tok;
+    seek();
+    m_ready = false;
+    return m_nextToken;
 }
 
-Token const& Lexer::seek() const
-{ return m_nextToken; }
+Token const& Lexer::seek()
+{
+    if (!m_ready)
+    {
+        m_nextToken = M_getToken();
+        m_ready = true;
+    }
+    return m_nextToken;
+}
+
+void Lexer::position(std::size_t offset, std::size_t& line, std::size_t& column) const
+{
+    if (m_lines.empty())
+    {
+        m_lines.push_back(0);
+        for (char const* ptr = m_begin; (ptr = std::find(ptr, m_end, '\n')) != m_end; ++ptr)
+            m_lines.push_back(ptr - m_begin + 1);
+    }
+
+    // The line containing offset is the last one starting at or before it
+    std::vector<std::size_t>::const_iterator it =
+        std::upper_bound(m_lines.begin(), m_lines.end(), offset) - 1;
+
+    line = it - m_lines.begin() + 1;
+    column = offset - *it + 1;
+}
 
 //! Init the lexer (called from constructors).
+//! Nothing is read before the first token is needed.
 void Lexer::M_init()
 {
-    m_currentInfo.line = 1;
-    m_currentInfo.column = 0;
-
-    // Get first char (m_nextChar is now valid)
-    m_nextChar = 0;
-    M_getChar();
-    // Get first token (m_nextToken is now valid)
-    m_nextToken = M_getToken();
+    m_ptr = m_begin;
+    m_nextChar = pendingChar;
+    m_ready = false;
+}
+
+//! Read the four hexadecimal digits following a \\u escape, and
+//!   append the UTF-8 encoding of the code point to value.
+//! Surrogate pairs are expected as two consecutive escapes.
+bool Lexer::M_unicode(std::string& value)
+{
+    unsigned int cp = 0;
+    if (!M_hex4(cp))
+        return false;
+
+    if (cp >= 0xD800 && cp < 0xDC00)
+    {
+        unsigned int low = 0;
+        if (M_getChar() != '\\' || M_getChar() != 'u' || !M_hex4(low))
+            return false;
+        if (low < 0xDC00 || low >= 0xE000)
+            return false;
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+    }
+    else if (cp >= 0xDC00 && cp < 0xE000)
+        return false;
+
+    if (cp < 0x80)
+        value += (char) cp;
+    else if (cp < 0x800)
+    {
+        value += (char) (0xC0 | (cp >> 6));
+        value += (char) (0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        value += (char) (0xE0 | (cp >> 12));
+        value += (char) (0x80 | ((cp >> 6) & 0x3F));
+        value += (char) (0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        value += (char) (0xF0 | (cp >> 18));
+        value += (char) (0x80 | ((cp >> 12) & 0x3F));
+        value += (char) (0x80 | ((cp >> 6) & 0x3F));
+        value += (char) (0x80 | (cp & 0x3F));
+    }
+    return true;
+}
+
+bool Lexer::M_hex4(unsigned int& cp)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        int ch = M_getChar();
+        if (!std::isxdigit(ch))
+            return false;
+        cp = cp * 16 + (std::isdigit(ch) ? ch - '0' : std::tolower(ch) - 'a' + 10);
+    }
+    return true;
 }
 
-//! Exctract a character from the input stream.
-//! This method manages the position in the input
-//!   stream for debug and error messages purposes.
+//! Exctract a character from the input.
+//! Only the byte offset is maintained, lines and columns being
+//!   computed on demand (see position()).
 int Lexer::M_getChar()
 {
-    int ch = m_nextChar;
-    m_nextChar = m_in.get();
+    int ch = M_eat();
+    M_peek();
+    return ch;
+}
 
-    // Update stream information
-    if (ch == '\n')
+//! Extract a character without peeking the next one, so that
+//!   the last character of a token is the last one read from
+//!   a stream.
+int Lexer::M_eat()
+{
+    int ch = m_nextChar;
+    if (!m_in)
+    {
+        if (m_ptr < m_end)
+            ++m_ptr;
+        m_nextChar = pendingChar;
+    }
+    else if (ch >= 0)
     {
-        ++m_currentInfo.line;
-        m_currentInfo.column = 0;
+        m_in->rdbuf()->sbumpc();
+        ++m_offset;
+        if (ch == '\n')
+            m_lines.push_back(m_offset);
+        m_nextChar = pendingChar;
     }
-    ++m_currentInfo.column;
 
     return ch;
 }
 
+//! Make m_nextChar valid (-1 at the end of the input).
+void Lexer::M_peek()
+{
+    if (m_nextChar != pendingChar)
+        return;
+
+    if (!m_in)
+        m_nextChar = m_ptr < m_end ? (unsigned char) *m_ptr : -1;
+    else
+    {
+        std::streambuf* buf = m_in->rdbuf();
+        int ch = buf ? buf->sgetc() : std::char_traits<char>::eof();
+        if (ch == std::char_traits<char>::eof())
+        {
+            m_in->setstate(std::ios::eofbit);
+            m_nextChar = -1;
+        }
+        else
+            m_nextChar = ch;
+    }
+}
+
+//! Offset of m_nextChar.
+std::size_t Lexer::M_offset() const
+{
+    return m_in ? m_offset : m_ptr - m_begin;
+}
+
 //! Skip whitespaces (and new lines).
 void Lexer::M_skipWs()
 {
@@ -111,11 +253,13 @@ void Lexer::M_skip()
 Token Lexer::M_getToken()
 {
     // Skip whitespaces and comments
+    M_peek();
     M_skip();
 
     // Create token (bad by default), and save current stream information
     Token token = Token::Bad;
-    Token::Info info = m_currentInfo;
+    Token::Info info;
+    info.offset = M_offset();
 
     // Handle EOF gracefully
     if (m_nextChar < 0)
@@ -140,6 +284,8 @@ Token Lexer::M_getToken()
             token = M_matchKeyword(Token::True, "true");
         else if (m_nextChar == 'f')
             token = M_matchKeyword(Token::False, "false");
+        else if (m_nextChar == 'n')
+            token = M_matchKeyword(Token::Null, "null");
         else
         {
             // Includes
@@ -198,10 +344,20 @@ Token Lexer::M_getToken()
                             value += '\\';
                         else if (ch == '"')
                             value += '"';
+                        else if (ch == '/')
+                            value += '/';
                         else if (ch == 'n')
                             value += '\n';
                         else if (ch == 't')
-                            value += 't';
+                            value += '\t';
+                        else if (ch == 'r')
+                            value += '\r';
+                        else if (ch == 'b')
+                            value += '\b';
+                        else if (ch == 'f')
+                            value += '\f';
+                        else if (ch == 'u')
+                            ok = M_unicode(value);
                         else
                             ok = false;
                     }
@@ -272,7 +428,7 @@ Token Lexer::M_getToken()
                         ok = false;
 
                     // Eventual exponent's sign
-                    if (m_nextChar == '-')
+                    if (m_nextChar == '-' || m_nextChar == '+')
                     {
                         value += M_getChar();
                         if (m_nextChar < 0)
@@ -301,6 +457,11 @@ Token Lexer::M_getToken()
 
         // Get the last char from previous rules
         if (eatlast && token.type() != Token::Bad)
+            M_eat();
+
+        // Bad tokens consume at least one char, so that the parser
+        //   can skip them when recovering from errors
+        if (token.type() == Token::Bad && M_offset() == info.offset)
             M_getChar();
     }
 
@@ -17,11 +17,74 @@
  */
 
 #include "lconf/json_node.h"
-#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cstring>
 
 using namespace lconf;
 using namespace json;
 
+namespace
+{
+    //! Generation of hashes that were never computed.
+    unsigned long const noGeneration = ~0UL;
+
+    //! Guards the other parents of shared containers.
+    std::mutex linkMutex;
+
+    //! 64 bits finalizer of MurmurHash3.
+    uint64_t mix(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+    uint64_t combine(uint64_t hash, uint64_t value)
+    {
+        return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+    }
+
+    //! Hashes combine a seed per type with the hash of the value,
+    //!   so that values of different types cannot collide
+    //!   through their bits alone.
+    uint64_t seed(Node::Type type)
+    {
+        return mix(0x9e3779b97f4a7c15ULL * (type + 1));
+    }
+
+    uint64_t hashNumber(double value)
+    {
+        // 0 and -0 are equal
+        if (value == 0)
+            value = 0;
+
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(double));
+        return combine(seed(Node::Number), mix(bits));
+    }
+
+    uint64_t hashBoolean(bool value)
+    {
+        return combine(seed(Node::Boolean), mix(value));
+    }
+
+    uint64_t hashString(std::string const& value)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (std::size_t i = 0; i < value.size(); ++i)
+        {
+            hash ^= (unsigned char) value[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return combine(seed(Node::String), mix(hash));
+    }
+}
+
 // Abstract node class
 std::string Node::typeName(Node::Type type)
 {
@@ -30,33 +93,375 @@ std::string Node::typeName(Node::Type type)
     else if (type == String) return "String";
     else if (type == Object) return "Object";
     else if (type == Array) return "Array";
+    else if (type == Null) return "Null";
     
     return "?";
 }
 
+//! Change tracking of a container, kept apart from it so that
+//!   children that outlive their parent can still report to it.
+struct Node::Link
+{
+    Link() :
+        generation(0),
+        owners(1),
+        parent(0),
+        shared(false),
+        hash(0),
+        hashGeneration(noGeneration)
+    {}
+    
+    std::atomic<unsigned long> generation;
+    std::atomic<unsigned int> owners;
+    std::atomic<Link*> parent;
+    //! Set once the container has other parents.
+    std::atomic<bool> shared;
+    std::vector<Link*> others;
+    //! Cached hash of the container (see Node::hash()).
+    std::atomic<uint64_t> hash;
+    std::atomic<unsigned long> hashGeneration;
+};
+
+unsigned long Node::generation() const
+{
+    std::atomic<Link*>* slot = M_slot();
+    Link* link = slot ? slot->load(std::memory_order_acquire) : 0;
+    return link ? link->generation.load(std::memory_order_acquire) : 0;
+}
+
+void Node::track() const
+{
+    std::vector<Node const*> pending(1, this);
+    while (!pending.empty())
+    {
+        Node const* node = pending.back();
+        pending.pop_back();
+        
+        if (node->type() == Object)
+        {
+            Link* link = M_link(node);
+            std::map<std::string, Node*> const& impl = ((ObjectNode const*) node)->impl();
+            for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+                if (it->second->M_slot())
+                {
+                    M_adopt(link, it->second);
+                    pending.push_back(it->second);
+                }
+        }
+        else if (node->type() == Array && ((ArrayNode const*) node)->storage() == ArrayNode::Generic)
+        {
+            Link* link = M_link(node);
+            std::vector<Node*> const& impl = ((ArrayNode const*) node)->impl();
+            for (std::size_t i = 0; i < impl.size(); ++i)
+                if (impl[i]->M_slot())
+                {
+                    M_adopt(link, impl[i]);
+                    pending.push_back(impl[i]);
+                }
+        }
+        else if (node->type() == Array)
+            M_link(node);
+    }
+}
+
+std::atomic<Node::Link*>* Node::M_slot() const
+{
+    return 0;
+}
+
+Node::Link* Node::M_link(Node const* node)
+{
+    std::atomic<Link*>& slot = *node->M_slot();
+    Link* link = slot.load(std::memory_order_acquire);
+    if (link)
+        return link;
+    
+    Link* created = new Link();
+    if (slot.compare_exchange_strong(link, created, std::memory_order_acq_rel))
+        return created;
+    delete created;
+    return link;
+}
+
+//! Children have a single parent unless they are shared: a container
+//!   that has been moved reports to its new parent only, while a shared
+//!   one reports to all of them.
+void Node::M_adopt(Link* parent, Node const* child)
+{
+    Link* link = M_link(child);
+    Link* current = link->parent.load(std::memory_order_acquire);
+    if (current == parent)
+        return;
+    
+    parent->owners.fetch_add(1, std::memory_order_relaxed);
+    if (!current && link->parent.compare_exchange_strong(current, parent, std::memory_order_acq_rel))
+        return;
+    if (current == parent)
+    {
+        M_release(parent);
+        return;
+    }
+    
+    if (child->owners() <= 1)
+    {
+        M_release(link->parent.exchange(parent, std::memory_order_acq_rel));
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(linkMutex);
+    for (std::size_t i = 0; i < link->others.size(); ++i)
+        if (link->others[i] == parent)
+        {
+            M_release(parent);
+            return;
+        }
+    link->others.push_back(parent);
+    link->shared.store(true, std::memory_order_release);
+}
+
+void Node::M_release(Link* link)
+{
+    while (link && link->owners.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        Link* parent = link->parent.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < link->others.size(); ++i)
+            M_release(link->others[i]);
+        delete link;
+        link = parent;
+    }
+}
+
+//! Tell if the cached hashes of two containers differ.
+bool Node::M_differ(Node const* a, Node const* b)
+{
+    Link* la = a->M_slot()->load(std::memory_order_acquire);
+    Link* lb = b->M_slot()->load(std::memory_order_acquire);
+    if (!la || !lb)
+        return false;
+    if (la->hashGeneration.load(std::memory_order_acquire) != la->generation.load(std::memory_order_acquire) ||
+        lb->hashGeneration.load(std::memory_order_acquire) != lb->generation.load(std::memory_order_acquire))
+        return false;
+    return la->hash.load(std::memory_order_relaxed) != lb->hash.load(std::memory_order_relaxed);
+}
+
+void Node::M_propagate(Link* link)
+{
+    for (; link; link = link->parent.load(std::memory_order_acquire))
+    {
+        link->generation.fetch_add(1, std::memory_order_acq_rel);
+        if (link->shared.load(std::memory_order_acquire))
+        {
+            std::vector<Link*> others;
+            {
+                std::lock_guard<std::mutex> lock(linkMutex);
+                others = link->others;
+            }
+            for (std::size_t i = 0; i < others.size(); ++i)
+                M_propagate(others[i]);
+        }
+    }
+}
+
 void Node::serialize(std::ostream& out, bool indent) const
 {
-    M_serialize(out, 0, indent);
+    Buffer buffer(out);
+    serialize(buffer, indent);
+    buffer.flush();
+}
+
+void Node::serialize(Buffer& out, bool indent) const
+{
+    Writer writer(out, indent);
+    M_serialize(writer);
+}
+
+void Node::serialize(std::ostream& out, Format format) const
+{
+    Buffer buffer(out);
+    serialize(buffer, format);
+    buffer.flush();
+}
+
+void Node::serialize(Buffer& out, Format format) const
+{
+    Writer writer(out, format);
+    M_serialize(writer);
+}
+
+bool Node::multiline() const
+{
+    return M_multiline();
+}
+
+uint64_t Node::hash() const
+{
+    return M_hash();
+}
+
+Node* Node::clone() const
+{
+    Node* root = M_shallowClone(this);
+
+    // Containers are filled from a stack of (source, copy) pairs
+    std::vector<std::pair<Node const*, Node*> > pending;
+    if (root->type() == Object || (root->type() == Array && ((ArrayNode*) root)->storage() == ArrayNode::Generic))
+        pending.push_back(std::make_pair(this, root));
+
+    try
+    {
+        while (!pending.empty())
+        {
+            Node const* source = pending.back().first;
+            Node* dest = pending.back().second;
+            pending.pop_back();
+
+            if (source->type() == Object)
+            {
+                std::map<std::string, Node*> const& impl = ((ObjectNode const*) source)->impl();
+                std::map<std::string, Node*>& copy = ((ObjectNode*) dest)->impl();
+                for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+                {
+                    Node* child = M_shallowClone(it->second);
+                    copy.insert(copy.end(), std::make_pair(it->first, child));
+                    if (child->type() == Object || child->type() == Array)
+                        pending.push_back(std::make_pair(it->second, child));
+                }
+            }
+            else if (((ArrayNode const*) source)->storage() == ArrayNode::Generic)
+            {
+                std::vector<Node*> const& impl = ((ArrayNode const*) source)->impl();
+                std::vector<Node*>& copy = ((ArrayNode*) dest)->impl();
+                copy.reserve(impl.size());
+                for (std::size_t i = 0; i < impl.size(); ++i)
+                {
+                    Node* child = M_shallowClone(impl[i]);
+                    copy.push_back(child);
+                    if (child->type() == Object || child->type() == Array)
+                        pending.push_back(std::make_pair(impl[i], child));
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        delete root;
+        throw;
+    }
+
+    return root;
+}
+
+Node* Node::share()
+{
+    m_owners.fetch_add(1, std::memory_order_relaxed);
+    return this;
+}
+
+void Node::release(Node* node)
+{
+    if (node && node->m_owners.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete node;
+}
+
+unsigned int Node::owners() const
+{
+    return m_owners.load(std::memory_order_relaxed);
+}
+
+//! Copy a scalar or a packed array, or create an empty container
+//!   of the same kind.
+Node* Node::M_shallowClone(Node const* node)
+{
+    switch (node->type())
+    {
+        case Number:
+        {
+            NumberNode const* num = (NumberNode const*) node;
+            return new NumberNode(num->value(), num->isSingle());
+        }
+
+        case Boolean:
+            return new BooleanNode(((BooleanNode const*) node)->value());
+
+        case String:
+            return new StringNode(((StringNode const*) node)->value());
+
+        case Object:
+            return new ObjectNode();
+
+        case Array:
+        {
+            ArrayNode const* arr = (ArrayNode const*) node;
+            ArrayNode* copy = new ArrayNode(arr->storage());
+            if (arr->storage() == ArrayNode::Numbers)
+            {
+                copy->numbers() = arr->numbers();
+                copy->setSingle(arr->isSingle());
+            }
+            else if (arr->storage() == ArrayNode::Booleans)
+                copy->booleans() = arr->booleans();
+            return copy;
+        }
+
+        default:
+            return new NullNode();
+    }
 }
 
 // Numeric value node
 
+NumberNode::NumberNode(double value, bool single) :
+    m_single(single),
+    m_value(value)
+{}
+
 NumberNode::NumberNode(float value) :
+    m_single(true),
+    m_value(value)
+{}
+
+NumberNode::NumberNode(int value) :
+    m_single(false),
+    m_value(value)
+{}
+
+NumberNode::NumberNode(unsigned int value) :
+    m_single(false),
+    m_value(value)
+{}
+
+NumberNode::NumberNode(long value) :
+    m_single(false),
+    m_value(value)
+{}
+
+NumberNode::NumberNode(unsigned long value) :
+    m_single(false),
+    m_value(value)
+{}
+
+NumberNode::NumberNode(long long value) :
+    m_single(false),
+    m_value(value)
+{}
+
+NumberNode::NumberNode(unsigned long long value) :
+    m_single(false),
     m_value(value)
 {}
 
 Node::Type NumberNode::type() const
 { return Number; }
 
-float NumberNode::value() const
+double NumberNode::value() const
 { return m_value; }
 
-void NumberNode::M_serialize(std::ostream& out, int level, bool indent) const
+bool NumberNode::isSingle() const
+{ return m_single; }
+
+void NumberNode::M_serialize(Writer& out) const
 {
-    std::string pre = "";
-    for (int i = 0; indent && i < level; ++i) pre += " ";
-    
-    out << pre << m_value;
+    out.value(m_value, m_single);
 }
 
 bool NumberNode::M_multiline() const
@@ -64,6 +469,11 @@ bool NumberNode::M_multiline() const
     return false;
 }
 
+uint64_t NumberNode::M_hash() const
+{
+    return hashNumber(m_value);
+}
+
 // Boolean value node
 
 BooleanNode::BooleanNode(bool value) :
@@ -76,12 +486,9 @@ Node::Type BooleanNode::type() const
 bool BooleanNode::value() const
 { return m_value; }
 
-void BooleanNode::M_serialize(std::ostream& out, int level, bool indent) const
+void BooleanNode::M_serialize(Writer& out) const
 {
-    std::string pre = "";
-    for (int i = 0; indent && i < level; ++i) pre += " ";
-    
-    out << pre << (m_value ? "true" : "false");
+    out.value(m_value);
 }
 
 bool BooleanNode::M_multiline() const
@@ -89,6 +496,11 @@ bool BooleanNode::M_multiline() const
     return false;
 }
 
+uint64_t BooleanNode::M_hash() const
+{
+    return hashBoolean(m_value);
+}
+
 // String value node
 
 StringNode::StringNode(std::string const& value) :
@@ -103,29 +515,14 @@ std::string const& StringNode::value() const
 
 std::string StringNode::escapedValue() const
 {
-    std::string escaped;
-
-    for (auto c : m_value)
-    {
-        if (c == '\n')
-            escaped += "\\n";
-        else if (c == '\t')
-            escaped += "\\t";
-        else if (c == '"')
-            escaped += "\\\"";
-        else
-            escaped += c;
-    }
-
-    return std::move(escaped);
+    Buffer buffer;
+    buffer.escaped(m_value.data(), m_value.size());
+    return buffer.str();
 }
 
-void StringNode::M_serialize(std::ostream& out, int level, bool indent) const
+void StringNode::M_serialize(Writer& out) const
 {
-    std::string pre = "";
-    for (int i = 0; indent && i < level; ++i) pre += " ";
-    
-    out << pre << '"' << escapedValue() << '"';
+    out.value(m_value);
 }
 
 bool StringNode::M_multiline() const
@@ -133,68 +530,81 @@ bool StringNode::M_multiline() const
     return false;
 }
 
+uint64_t StringNode::M_hash() const
+{
+    return hashString(m_value);
+}
+
+// Null node
+
+NullNode::NullNode()
+{}
+
+Node::Type NullNode::type() const
+{ return Null; }
+
+void NullNode::M_serialize(Writer& out) const
+{ out.null(); }
+
+bool NullNode::M_multiline() const
+{ return false; }
+
+uint64_t NullNode::M_hash() const
+{ return seed(Null); }
+
 // Object node
 
-ObjectNode::ObjectNode()
+ObjectNode::ObjectNode() :
+    m_link(0)
 {}
 
 ObjectNode::~ObjectNode()
 {
     for (std::map<std::string, Node*>::iterator it = m_impl.begin();
          it != m_impl.end(); ++it)
-         delete it->second;
+         release(it->second);
+    M_release(m_link.load(std::memory_order_relaxed));
 }
 
 Node::Type ObjectNode::type() const
 { return Object; }
 
-bool ObjectNode::exists(std::string const& key)
+bool ObjectNode::exists(std::string const& key) const
 { return m_impl.find(key) != m_impl.end(); }
 
 Node*& ObjectNode::get(std::string const& key)
-{ return m_impl[key]; }
+{
+    M_touch(m_link);
+    return m_impl[key];
+}
 
 Node* ObjectNode::get(std::string const& key) const
 { return m_impl.at(key); }
 
 std::map<std::string, Node*>& ObjectNode::impl()
-{ return m_impl; }
+{
+    M_touch(m_link);
+    return m_impl;
+}
 
 std::map<std::string, Node*> const& ObjectNode::impl() const
 { return m_impl; }
 
-void ObjectNode::M_serialize(std::ostream& out, int level, bool indent) const
+std::atomic<Node::Link*>* ObjectNode::M_slot() const
+{ return &m_link; }
+
+void ObjectNode::M_serialize(Writer& out) const
 {
-    std::string pre = "";
-    for (int i = 0; indent && i < level; ++i) pre += " ";
-    
-    out << pre << '{';
-    if (indent) out << std::endl;
+    out.beginObject();
     
     std::map<std::string, Node*>::const_iterator it;
     for (it = m_impl.begin(); it != m_impl.end(); ++it)
     {
-        if (indent) out << pre << "    ";
-        out << '"' << it->first << "\": ";
-        
-        if (indent && it->second->M_multiline())
-        {
-            out << std::endl;
-            it->second->M_serialize(out, level + 4, indent);
-        }
-        else
-        {
-            it->second->M_serialize(out, 0, false);
-        }
-        
-        // (++it)-- returns the next iterator value, leaving
-        //   it unchanged.
-        if ((++it)-- != m_impl.end())
-            out << ", ";
-        if (indent) out << std::endl;
+        out.key(it->first);
+        it->second->M_serialize(out);
     }
     
-    out << pre << '}';
+    out.endObject();
 }
 
 bool ObjectNode::M_multiline() const
@@ -202,73 +612,374 @@ bool ObjectNode::M_multiline() const
     return true;
 }
 
+uint64_t ObjectNode::M_hash() const
+{
+    Link* link = M_link(this);
+    unsigned long generation = link->generation.load(std::memory_order_acquire);
+    if (link->hashGeneration.load(std::memory_order_acquire) == generation)
+        return link->hash.load(std::memory_order_relaxed);
+
+    uint64_t hash = combine(seed(Object), mix(m_impl.size()));
+    for (std::map<std::string, Node*>::const_iterator it = m_impl.begin();
+         it != m_impl.end(); ++it)
+    {
+        if (it->second->M_slot())
+            M_adopt(link, it->second);
+        hash = combine(hash, hashString(it->first));
+        hash = combine(hash, it->second->hash());
+    }
+
+    link->hash.store(hash, std::memory_order_relaxed);
+    link->hashGeneration.store(generation, std::memory_order_release);
+    return hash;
+}
+
 // Array node
 
-ArrayNode::ArrayNode()
+//! Nodes of the elements of a packed array, created one by one
+//!   by concurrent readers.
+struct ArrayNode::Nodes
+{
+    explicit Nodes(std::size_t size) :
+        size(size),
+        nodes(new std::atomic<Node*>[size]())
+    {}
+    
+    ~Nodes()
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            if (Node* node = nodes[i].load(std::memory_order_relaxed))
+                release(node);
+        delete[] nodes;
+    }
+    
+    std::size_t size;
+    std::atomic<Node*>* nodes;
+};
+
+ArrayNode::ArrayNode() :
+    m_storage(Generic),
+    m_single(false),
+    m_nodes(0),
+    m_link(0)
+{}
+
+ArrayNode::ArrayNode(Storage storage) :
+    m_storage(storage),
+    m_single(false),
+    m_nodes(0),
+    m_link(0)
 {}
 
 ArrayNode::~ArrayNode()
 {
+    M_dropNodes();
     for (unsigned int i = 0; i < m_impl.size(); ++i)
-        delete m_impl[i];
+        release(m_impl[i]);
+    M_release(m_link.load(std::memory_order_relaxed));
 }
 
 Node::Type ArrayNode::type() const
 { return Array; }
 
+ArrayNode::Storage ArrayNode::storage() const
+{ return m_storage; }
+
 size_t ArrayNode::size() const
-{ return m_impl.size(); }
+{
+    if (m_storage == Numbers) return m_numbers.size();
+    else if (m_storage == Booleans) return m_booleans.size();
+    return m_impl.size();
+}
 
 Node*& ArrayNode::at(size_t i)
 {
+    M_touch(m_link);
+    M_unpack();
     if (i >= m_impl.size()) throw std::domain_error("json::ArrayNode::at: index out of bounds");
     return m_impl[i];
 }
 
 Node* ArrayNode::at(size_t i) const
 {
-    if (i >= m_impl.size()) throw std::domain_error("json::ArrayNode::at: index out of bounds");
+    if (i >= size()) throw std::domain_error("json::ArrayNode::at: index out of bounds");
+    if (m_storage != Generic)
+        return M_node(i);
     return m_impl[i];
 }
 
 std::vector<Node*>& ArrayNode::impl()
-{ return m_impl; }
+{
+    M_touch(m_link);
+    M_unpack();
+    return m_impl;
+}
 
 std::vector<Node*> const& ArrayNode::impl() const
-{ return m_impl; }
+{
+    if (m_storage != Generic) throw std::domain_error("json::ArrayNode::impl: array is packed");
+    return m_impl;
+}
+
+std::vector<double>& ArrayNode::numbers()
+{
+    M_touch(m_link);
+    if (m_storage != Numbers) throw std::domain_error("json::ArrayNode::numbers: array is not packed with numbers");
+    M_dropNodes();
+    return m_numbers;
+}
 
-void ArrayNode::M_serialize(std::ostream& out, int level, bool indent) const
+std::vector<double> const& ArrayNode::numbers() const
 {
-    std::string pre = "";
-    for (int i = 0; indent && i < level; ++i) pre += " ";
+    if (m_storage != Numbers) throw std::domain_error("json::ArrayNode::numbers: array is not packed with numbers");
+    return m_numbers;
+}
+
+void ArrayNode::setSingle(bool single)
+{
+    M_dropNodes();
+    m_single = single;
+}
+
+bool ArrayNode::isSingle() const
+{ return m_single; }
+
+std::vector<bool>& ArrayNode::booleans()
+{
+    M_touch(m_link);
+    if (m_storage != Booleans) throw std::domain_error("json::ArrayNode::booleans: array is not packed with booleans");
+    M_dropNodes();
+    return m_booleans;
+}
+
+std::vector<bool> const& ArrayNode::booleans() const
+{
+    if (m_storage != Booleans) throw std::domain_error("json::ArrayNode::booleans: array is not packed with booleans");
+    return m_booleans;
+}
+
+std::atomic<Node::Link*>* ArrayNode::M_slot() const
+{ return &m_link; }
+
+//! Convert a packed array to a generic one, creating a node for
+//!   each of its elements (or taking the one read through at() const).
+void ArrayNode::M_unpack()
+{
+    if (m_storage == Generic)
+        return;
     
-    out << pre << '[';
-    bool multi = indent && M_multiline();
-    if (multi) out << std::endl;
+    Nodes* nodes = m_nodes.exchange(0);
+    std::size_t size = this->size();
+    m_impl.reserve(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        Node* node = 0;
+        if (nodes && i < nodes->size)
+            node = nodes->nodes[i].exchange(0);
+        if (!node && m_storage == Numbers)
+            node = new NumberNode(m_numbers[i], m_single);
+        else if (!node)
+            node = new BooleanNode(m_booleans[i]);
+        m_impl.push_back(node);
+    }
+    delete nodes;
     
-    for (unsigned int i = 0; i < m_impl.size(); ++i)
+    std::vector<double>().swap(m_numbers);
+    std::vector<bool>().swap(m_booleans);
+    m_storage = Generic;
+}
+
+//! Node of the i-th element of a packed array, created once
+//!   (whichever reader comes first) and kept in m_nodes.
+Node* ArrayNode::M_node(size_t i) const
+{
+    Nodes* nodes = m_nodes.load(std::memory_order_acquire);
+    if (!nodes)
     {
-        if (multi)
-        {
-            m_impl[i]->M_serialize(out, level + 4, indent);
-        }
+        Nodes* created = new Nodes(size());
+        if (m_nodes.compare_exchange_strong(nodes, created, std::memory_order_acq_rel))
+            nodes = created;
         else
-        {
-            m_impl[i]->M_serialize(out, 0, false);
-        }
+            delete created;
+    }
+    if (i >= nodes->size)
+        throw std::logic_error("json::ArrayNode::at: packed values changed while their nodes were read");
+    
+    Node* node = nodes->nodes[i].load(std::memory_order_acquire);
+    if (!node)
+    {
+        Node* created;
+        if (m_storage == Numbers)
+            created = new NumberNode(m_numbers[i], m_single);
+        else
+            created = new BooleanNode(m_booleans[i]);
         
-        if (i != m_impl.size()-1)
-            out << ", ";
-        if (multi) out << std::endl;
+        if (nodes->nodes[i].compare_exchange_strong(node, created, std::memory_order_acq_rel))
+            node = created;
+        else
+            delete created;
+    }
+    return node;
+}
+
+//! Drop the nodes read through at() const, before the
+//!   packed values are changed.
+void ArrayNode::M_dropNodes()
+{
+    if (m_nodes.load(std::memory_order_relaxed))
+        delete m_nodes.exchange(0);
+}
+
+void ArrayNode::M_serialize(Writer& out) const
+{
+    out.beginArray(M_multiline());
+    
+    // Packed arrays are written directly from their values
+    if (m_storage == Numbers)
+    {
+        for (unsigned int i = 0; i < m_numbers.size(); ++i)
+            out.value(m_numbers[i], m_single);
+    }
+    else if (m_storage == Booleans)
+    {
+        for (unsigned int i = 0; i < m_booleans.size(); ++i)
+            out.value(static_cast<bool>(m_booleans[i]));
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_impl.size(); ++i)
+            m_impl[i]->M_serialize(out);
     }
     
-    out << pre << ']';
+    out.endArray();
 }
 
 bool ArrayNode::M_multiline() const
 {
+    if (m_storage != Generic)
+        return false;
+    
     for (unsigned int i = 0; i < m_impl.size(); ++i)
         if (m_impl[i]->M_multiline())
             return true;
     return false;
 }
+
+uint64_t ArrayNode::M_hash() const
+{
+    Link* link = M_link(this);
+    unsigned long generation = link->generation.load(std::memory_order_acquire);
+    if (link->hashGeneration.load(std::memory_order_acquire) == generation)
+        return link->hash.load(std::memory_order_relaxed);
+
+    uint64_t hash = combine(seed(Array), mix(size()));
+    if (m_storage == Numbers)
+    {
+        for (unsigned int i = 0; i < m_numbers.size(); ++i)
+            hash = combine(hash, hashNumber(m_numbers[i]));
+    }
+    else if (m_storage == Booleans)
+    {
+        for (unsigned int i = 0; i < m_booleans.size(); ++i)
+            hash = combine(hash, hashBoolean(m_booleans[i]));
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_impl.size(); ++i)
+        {
+            if (m_impl[i]->M_slot())
+                M_adopt(link, m_impl[i]);
+            hash = combine(hash, m_impl[i]->hash());
+        }
+    }
+
+    link->hash.store(hash, std::memory_order_relaxed);
+    link->hashGeneration.store(generation, std::memory_order_release);
+    return hash;
+}
+
+// Deep equality
+
+namespace
+{
+    //! Compare the i-th element of an array with a node.
+    bool equalElement(ArrayNode const* arr, std::size_t i, Node const* node)
+    {
+        if (arr->storage() == ArrayNode::Numbers)
+            return node->type() == Node::Number &&
+                ((NumberNode const*) node)->value() == arr->numbers()[i];
+        if (arr->storage() == ArrayNode::Booleans)
+            return node->type() == Node::Boolean &&
+                ((BooleanNode const*) node)->value() == arr->booleans()[i];
+        return equal(arr->at(i), node);
+    }
+}
+
+namespace lconf { namespace json
+{
+    bool equal(Node const* a, Node const* b)
+    {
+        if (a == b)
+            return true;
+        if (a->type() != b->type())
+            return false;
+
+        switch (a->type())
+        {
+            case Node::Number:
+                return ((NumberNode const*) a)->value() == ((NumberNode const*) b)->value();
+
+            case Node::Boolean:
+                return ((BooleanNode const*) a)->value() == ((BooleanNode const*) b)->value();
+
+            case Node::String:
+                return ((StringNode const*) a)->value() == ((StringNode const*) b)->value();
+
+            case Node::Object:
+            {
+                ObjectNode const* oa = (ObjectNode const*) a;
+                ObjectNode const* ob = (ObjectNode const*) b;
+                if (oa->m_impl.size() != ob->m_impl.size())
+                    return false;
+                if (Node::M_differ(oa, ob))
+                    return false;
+
+                std::map<std::string, Node*>::const_iterator ita = oa->m_impl.begin();
+                std::map<std::string, Node*>::const_iterator itb = ob->m_impl.begin();
+                for (; ita != oa->m_impl.end(); ++ita, ++itb)
+                    if (ita->first != itb->first || !equal(ita->second, itb->second))
+                        return false;
+                return true;
+            }
+
+            case Node::Array:
+            {
+                ArrayNode const* aa = (ArrayNode const*) a;
+                ArrayNode const* ab = (ArrayNode const*) b;
+                if (aa->size() != ab->size())
+                    return false;
+                if (Node::M_differ(aa, ab))
+                    return false;
+
+                if (aa->m_storage == ArrayNode::Numbers && ab->m_storage == ArrayNode::Numbers)
+                    return aa->m_numbers == ab->m_numbers;
+                if (aa->m_storage == ArrayNode::Booleans && ab->m_storage == ArrayNode::Booleans)
+                    return aa->m_booleans == ab->m_booleans;
+
+                if (aa->m_storage != ArrayNode::Generic && ab->m_storage != ArrayNode::Generic)
+                    return aa->size() == 0;
+
+                // Packed elements are compared without creating their nodes
+                if (aa->m_storage != ArrayNode::Generic)
+                    std::swap(aa, ab);
+                for (std::size_t i = 0; i < aa->size(); ++i)
+                    if (!equalElement(ab, i, aa->m_impl[i]))
+                        return false;
+                return true;
+            }
+
+            default:
+                return true;
+        }
+    }
+} }
@@ -0,0 +1,372 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_number.h"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+
+using namespace lconf;
+using namespace json;
+
+//! The floating point formatting below is an implementation of the Grisu2
+//!   algorithm, from F. Loitsch, "Printing Floating-Point Numbers Quickly
+//!   and Accurately with Integers" (PLDI 2010).
+
+namespace
+{
+    uint64_t const pow10[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+        100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+        10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+        100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+    };
+
+    char const digit_pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    //! Binary floating point number f * 2^e, with a 64-bit significand.
+    struct DiyFp
+    {
+        DiyFp(uint64_t f = 0, int e = 0) :
+            f(f), e(e)
+        {}
+
+        DiyFp operator-(DiyFp const& rhs) const
+        { return DiyFp(f - rhs.f, e); }
+
+        //! Rounded product of the significands.
+        DiyFp operator*(DiyFp const& rhs) const
+        {
+            uint64_t const m32 = 0xFFFFFFFFULL;
+            uint64_t a = f >> 32, b = f & m32;
+            uint64_t c = rhs.f >> 32, d = rhs.f & m32;
+            uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+            uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32) + (1ULL << 31);
+            return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+        }
+
+        DiyFp normalized() const
+        {
+#if defined(__GNUC__)
+            int shift = __builtin_clzll(f);
+#else
+            int shift = 0;
+            while (!(f & (1ULL << (63 - shift)))) ++shift;
+#endif
+            return DiyFp(f << shift, e - shift);
+        }
+
+        uint64_t f;
+        int e;
+    };
+
+    //! Cached powers of ten 10^k, for k = -348, -340, ..., 340.
+    struct CachedPower
+    {
+        uint64_t f;
+        int e;
+    };
+
+    CachedPower const cached_powers[] = {
+        { 0xfa8fd5a0081c0288ULL, -1220 }, { 0xbaaee17fa23ebf76ULL, -1193 },
+        { 0x8b16fb203055ac76ULL, -1166 }, { 0xcf42894a5dce35eaULL, -1140 },
+        { 0x9a6bb0aa55653b2dULL, -1113 }, { 0xe61acf033d1a45dfULL, -1087 },
+        { 0xab70fe17c79ac6caULL, -1060 }, { 0xff77b1fcbebcdc4fULL, -1034 },
+        { 0xbe5691ef416bd60cULL, -1007 }, { 0x8dd01fad907ffc3cULL, -980 },
+        { 0xd3515c2831559a83ULL, -954 }, { 0x9d71ac8fada6c9b5ULL, -927 },
+        { 0xea9c227723ee8bcbULL, -901 }, { 0xaecc49914078536dULL, -874 },
+        { 0x823c12795db6ce57ULL, -847 }, { 0xc21094364dfb5637ULL, -821 },
+        { 0x9096ea6f3848984fULL, -794 }, { 0xd77485cb25823ac7ULL, -768 },
+        { 0xa086cfcd97bf97f4ULL, -741 }, { 0xef340a98172aace5ULL, -715 },
+        { 0xb23867fb2a35b28eULL, -688 }, { 0x84c8d4dfd2c63f3bULL, -661 },
+        { 0xc5dd44271ad3cdbaULL, -635 }, { 0x936b9fcebb25c996ULL, -608 },
+        { 0xdbac6c247d62a584ULL, -582 }, { 0xa3ab66580d5fdaf6ULL, -555 },
+        { 0xf3e2f893dec3f126ULL, -529 }, { 0xb5b5ada8aaff80b8ULL, -502 },
+        { 0x87625f056c7c4a8bULL, -475 }, { 0xc9bcff6034c13053ULL, -449 },
+        { 0x964e858c91ba2655ULL, -422 }, { 0xdff9772470297ebdULL, -396 },
+        { 0xa6dfbd9fb8e5b88fULL, -369 }, { 0xf8a95fcf88747d94ULL, -343 },
+        { 0xb94470938fa89bcfULL, -316 }, { 0x8a08f0f8bf0f156bULL, -289 },
+        { 0xcdb02555653131b6ULL, -263 }, { 0x993fe2c6d07b7facULL, -236 },
+        { 0xe45c10c42a2b3b06ULL, -210 }, { 0xaa242499697392d3ULL, -183 },
+        { 0xfd87b5f28300ca0eULL, -157 }, { 0xbce5086492111aebULL, -130 },
+        { 0x8cbccc096f5088ccULL, -103 }, { 0xd1b71758e219652cULL, -77 },
+        { 0x9c40000000000000ULL, -50 }, { 0xe8d4a51000000000ULL, -24 },
+        { 0xad78ebc5ac620000ULL, 3 }, { 0x813f3978f8940984ULL, 30 },
+        { 0xc097ce7bc90715b3ULL, 56 }, { 0x8f7e32ce7bea5c70ULL, 83 },
+        { 0xd5d238a4abe98068ULL, 109 }, { 0x9f4f2726179a2245ULL, 136 },
+        { 0xed63a231d4c4fb27ULL, 162 }, { 0xb0de65388cc8ada8ULL, 189 },
+        { 0x83c7088e1aab65dbULL, 216 }, { 0xc45d1df942711d9aULL, 242 },
+        { 0x924d692ca61be758ULL, 269 }, { 0xda01ee641a708deaULL, 295 },
+        { 0xa26da3999aef774aULL, 322 }, { 0xf209787bb47d6b85ULL, 348 },
+        { 0xb454e4a179dd1877ULL, 375 }, { 0x865b86925b9bc5c2ULL, 402 },
+        { 0xc83553c5c8965d3dULL, 428 }, { 0x952ab45cfa97a0b3ULL, 455 },
+        { 0xde469fbd99a05fe3ULL, 481 }, { 0xa59bc234db398c25ULL, 508 },
+        { 0xf6c69a72a3989f5cULL, 534 }, { 0xb7dcbf5354e9beceULL, 561 },
+        { 0x88fcf317f22241e2ULL, 588 }, { 0xcc20ce9bd35c78a5ULL, 614 },
+        { 0x98165af37b2153dfULL, 641 }, { 0xe2a0b5dc971f303aULL, 667 },
+        { 0xa8d9d1535ce3b396ULL, 694 }, { 0xfb9b7cd9a4a7443cULL, 720 },
+        { 0xbb764c4ca7a44410ULL, 747 }, { 0x8bab8eefb6409c1aULL, 774 },
+        { 0xd01fef10a657842cULL, 800 }, { 0x9b10a4e5e9913129ULL, 827 },
+        { 0xe7109bfba19c0c9dULL, 853 }, { 0xac2820d9623bf429ULL, 880 },
+        { 0x80444b5e7aa7cf85ULL, 907 }, { 0xbf21e44003acdd2dULL, 933 },
+        { 0x8e679c2f5e44ff8fULL, 960 }, { 0xd433179d9c8cb841ULL, 986 },
+        { 0x9e19db92b4e31ba9ULL, 1013 }, { 0xeb96bf6ebadf77d9ULL, 1039 },
+        { 0xaf87023b9bf0ee6bULL, 1066 },
+    };
+
+    //! Get a cached power c_k such that the binary exponent of
+    //!   c_k * 2^e lies in [-60, -32], and set K to -k.
+    DiyFp cachedPower(int e, int& K)
+    {
+        double dk = (-61 - e) * 0.30102999566398114 + 347;
+        int k = static_cast<int>(dk);
+        if (dk - k > 0.0)
+            ++k;
+
+        unsigned index = static_cast<unsigned>((k >> 3) + 1);
+        K = -(-348 + static_cast<int>(index << 3));
+        return DiyFp(cached_powers[index].f, cached_powers[index].e);
+    }
+
+    int countDigits(uint32_t n)
+    {
+        int count = 1;
+        while (count < 10 && n >= pow10[count])
+            ++count;
+        return count;
+    }
+
+    void round(char* digits, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+    {
+        while (rest < wp_w && delta - rest >= ten_kappa &&
+               (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+        {
+            --digits[length - 1];
+            rest += ten_kappa;
+        }
+    }
+
+    //! Generate the shortest digits of W within [Mp - delta, Mp].
+    void generateDigits(DiyFp const& W, DiyFp const& Mp, uint64_t delta, char* digits, int& length, int& K)
+    {
+        DiyFp one(1ULL << -Mp.e, Mp.e);
+        DiyFp wp_w = Mp - W;
+        uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+        uint64_t p2 = Mp.f & (one.f - 1);
+        int kappa = countDigits(p1);
+        length = 0;
+
+        // Integral part
+        while (kappa > 0)
+        {
+            uint32_t d = static_cast<uint32_t>(p1 / pow10[kappa - 1]);
+            p1 %= pow10[kappa - 1];
+            if (d || length)
+                digits[length++] = static_cast<char>('0' + d);
+            --kappa;
+
+            uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+            if (rest <= delta)
+            {
+                K += kappa;
+                round(digits, length, delta, rest, pow10[kappa] << -one.e, wp_w.f);
+                return;
+            }
+        }
+
+        // Fractional part
+        for (;;)
+        {
+            p2 *= 10;
+            delta *= 10;
+            char d = static_cast<char>(p2 >> -one.e);
+            if (d || length)
+                digits[length++] = static_cast<char>('0' + d);
+            p2 &= one.f - 1;
+            --kappa;
+
+            if (p2 < delta)
+            {
+                K += kappa;
+                int index = -kappa;
+                round(digits, length, delta, p2, one.f, wp_w.f * (index < 20 ? pow10[index] : 0));
+                return;
+            }
+        }
+    }
+
+    //! Compute the shortest digits of a positive, finite value
+    //!   (value = digits * 10^K).
+    void grisu2(double value, bool single, char* digits, int& length, int& K)
+    {
+        uint64_t f;
+        int e, bits;
+        bool lower_closer;
+
+        if (single)
+        {
+            float fvalue = static_cast<float>(value);
+            uint32_t u;
+            std::memcpy(&u, &fvalue, sizeof(u));
+            int biased = (u >> 23) & 0xFF;
+            bits = 23;
+            f = u & 0x7FFFFF;
+            e = biased ? biased - 150 : -149;
+            if (biased) f |= 1ULL << bits;
+            lower_closer = biased > 1 && !(u & 0x7FFFFF);
+        }
+        else
+        {
+            uint64_t u;
+            std::memcpy(&u, &value, sizeof(u));
+            int biased = static_cast<int>((u >> 52) & 0x7FF);
+            bits = 52;
+            f = u & 0xFFFFFFFFFFFFFULL;
+            e = biased ? biased - 1075 : -1074;
+            if (biased) f |= 1ULL << bits;
+            lower_closer = biased > 1 && !(u & 0xFFFFFFFFFFFFFULL);
+        }
+
+        // Boundaries of the rounding interval of value
+        DiyFp v(f, e);
+        DiyFp plus = DiyFp((f << 1) + 1, e - 1).normalized();
+        DiyFp minus = lower_closer ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+
+        DiyFp c_mk = cachedPower(plus.e, K);
+        DiyFp W = v.normalized() * c_mk;
+        DiyFp Wp = plus * c_mk;
+        DiyFp Wm = minus * c_mk;
+
+        // Stay conservatively inside the interval. Single precision values
+        //   are parsed back as doubles before being rounded to floats, so
+        //   their digits must also be farther than half a double ulp
+        //   from the boundaries.
+        uint64_t margin = single ? 1ULL << 12 : 1;
+        Wm.f += margin;
+        Wp.f -= margin;
+
+        generateDigits(W, Wp, Wp.f - Wm.f, digits, length, K);
+    }
+
+    char* writeUnsigned(uint64_t value, char* out)
+    {
+        char digits[20];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+
+        while (value >= 100)
+        {
+            unsigned pair = static_cast<unsigned>(value % 100);
+            value /= 100;
+            *--p = digit_pairs[2*pair + 1];
+            *--p = digit_pairs[2*pair];
+        }
+        if (value >= 10)
+        {
+            *--p = digit_pairs[2*value + 1];
+            *--p = digit_pairs[2*value];
+        }
+        else
+            *--p = static_cast<char>('0' + value);
+
+        std::memcpy(out, p, end - p);
+        return out + (end - p);
+    }
+
+    char* writeExponent(int exponent, char* out)
+    {
+        *out++ = 'e';
+        if (exponent < 0)
+        {
+            *out++ = '-';
+            exponent = -exponent;
+        }
+        return writeUnsigned(static_cast<uint64_t>(exponent), out);
+    }
+
+    //! Lay out digits * 10^K in decimal or scientific notation.
+    char* prettify(char* digits, int length, int K, char* out)
+    {
+        // Position of the decimal point relative to the first digit
+        int point = length + K;
+
+        if (K >= 0 && point <= 21)
+        {
+            // Integer (1234e7 -> 12340000000)
+            std::memcpy(out, digits, length);
+            std::memset(out + length, '0', K);
+            return out + point;
+        }
+        else if (point > 0 && point <= 21)
+        {
+            // Decimal (1234e-2 -> 12.34)
+            std::memcpy(out, digits, point);
+            out[point] = '.';
+            std::memcpy(out + point + 1, digits + point, length - point);
+            return out + length + 1;
+        }
+        else if (point > -6 && point <= 0)
+        {
+            // Small decimal (1234e-6 -> 0.001234)
+            *out++ = '0';
+            *out++ = '.';
+            std::memset(out, '0', -point);
+            std::memcpy(out - point, digits, length);
+            return out - point + length;
+        }
+
+        // Scientific notation (1234e30 -> 1.234e33)
+        *out++ = digits[0];
+        if (length > 1)
+        {
+            *out++ = '.';
+            std::memcpy(out, digits + 1, length - 1);
+            out += length - 1;
+        }
+        return writeExponent(point - 1, out);
+    }
+}
+
+std::size_t json::formatNumber(double value, char* out, bool single)
+{
+    char* start = out;
+
+    if (!std::isfinite(value))
+        throw std::domain_error("json::formatNumber: non-finite numbers can not be written");
+
+    if (std::signbit(value))
+    {
+        *out++ = '-';
+        value = -value;
+    }
+
+    // Integers that are exactly representable get a fast path
+    if (value < 9007199254740992.0 && value == std::floor(value))
+        return writeUnsigned(static_cast<uint64_t>(value), out) - start;
+
+    char digits[NumberLength];
+    int length, K;
+    grisu2(value, single, digits, length, K);
+    return prettify(digits, length, K, out) - start;
+}
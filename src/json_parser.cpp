@@ -20,18 +20,85 @@
 #include "lconf/json.h"
 #include <stdexcept>
 #include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
 
 using namespace lconf;
 using namespace json;
 
+namespace
+{
+    //! Convert a number token, returning false if it overflows
+    //!   (it would not be written back otherwise).
+    bool toNumber(std::string const& str, double& value)
+    {
+        value = std::strtod(str.c_str(), 0);
+        return !std::isinf(value);
+    }
+}
+
 Parser::Parser(Lexer& lex) :
-    m_lex(lex)
+    m_lex(lex),
+    m_status(0),
+    m_errors(0)
 {}
 
 Parser::~Parser()
 {}
 
 Node* Parser::parse()
+{
+    Status status;
+    Node* node = parse(status);
+    if (!node)
+        status.raise();
+    return node;
+}
+
+Node* Parser::parse(Status& status)
+{
+    m_status = &status;
+    m_errors = 0;
+    status.clear();
+
+    return M_root();
+}
+
+Node* Parser::parse(std::vector<Status>& errors)
+{
+    Status status;
+    m_status = &status;
+    m_errors = &errors;
+    errors.clear();
+    m_offsets.clear();
+
+    std::size_t offset = m_lex.seek().info().offset;
+    Node* node = M_root();
+    if (!node)
+        return 0;
+    m_offsets[node] = offset;
+
+    // The document must end with its root value
+    if (m_lex.seek().type() != Token::Eof)
+        M_error(m_lex.seek(), "expected end of document after the root value");
+    return node;
+}
+
+bool Parser::position(Node const* node, std::size_t& line, std::size_t& column) const
+{
+    std::unordered_map<Node const*, std::size_t>::const_iterator it = m_offsets.find(node);
+    if (it == m_offsets.end())
+        return false;
+
+    m_lex.position(it->second, line, column);
+    return true;
+}
+
+std::vector<std::string> const& Parser::includes() const
+{ return m_includes; }
+
+Node* Parser::M_root()
 {
     if (m_lex.seek().type() == Token::LeftBrace)
         return M_object();
@@ -40,11 +107,23 @@ Node* Parser::parse()
 }
 
 Node* Parser::M_atom()
+{
+    if (!m_errors)
+        return M_value();
+
+    std::size_t offset = m_lex.seek().info().offset;
+    Node* node = M_value();
+    if (node)
+        m_offsets[node] = offset;
+    return node;
+}
+
+Node* Parser::M_value()
 {
     Token next = m_lex.seek();
     if (next.type() == Token::Bad)
     {
-        M_error(next, "bad token");
+        return M_error(next, "bad token");
     }
     else if (next.type() == Token::True ||
              next.type() == Token::False)
@@ -52,17 +131,17 @@ Node* Parser::M_atom()
         m_lex.get();
         return new BooleanNode(next.type() == Token::True);
     }
+    else if (next.type() == Token::Null)
+    {
+        m_lex.get();
+        return new NullNode();
+    }
     else if (next.type() == Token::Number)
     {
+        double value;
+        if (!toNumber(next.value(), value))
+            return M_error(next, "number out of range");
         m_lex.get();
-        
-        float value;
-        try {
-            value = std::stof(next.value());
-        } catch (std::exception const&) {
-            value = 0.0f;
-        }
-
         return new NumberNode(value);
     }
     else if (next.type() == Token::String)
@@ -76,19 +155,37 @@ Node* Parser::M_atom()
         return M_array();
     else if (next.type() == Token::Include)
     {
-        Node* tree = ::parse(next.value());
+        std::ifstream fs(next.value(), std::ios::in);
+        if (!fs)
+        {
+            m_status->fail(Status::IoError, "json::parse: unable to open \"" + next.value() + "\"");
+            M_record();
+            return 0;
+        }
+
+        // The included file reports its errors the same way
+        Lexer lexer(fs);
+        Parser parser(lexer);
+        parser.m_status = m_status;
+        parser.m_errors = m_errors;
+        Node* tree = parser.M_root();
+        if (!tree)
+            return 0;
+
+        m_includes.push_back(next.value());
+        m_includes.insert(m_includes.end(), parser.includes().begin(), parser.includes().end());
         m_lex.get();
         return tree;
     }
 
-    return 0;
+    return M_error(next, "expected a value");
 }
 
 Node* Parser::M_object()
 {
     // Eat the opening {
     if (m_lex.seek().type() != Token::LeftBrace)
-        M_error(m_lex.seek(), "expected `{' at beginning of object declaration");
+        return M_error(m_lex.seek(), "expected `{' at beginning of object declaration");
     m_lex.get();
 
     // Create appropriate node
@@ -101,78 +198,213 @@ Node* Parser::M_object()
         if (m_lex.seek().type() == Token::RightBrace)
             break;
 
-        // Get key identifier
-        if (m_lex.seek().type() != Token::String)
-            M_error(m_lex.seek(), "expected a identifier key");
-        Token token = m_lex.get();
-        std::string key = token.value();
+        bool ok = M_entry(node);
 
-        if (node->exists(key))
-            M_error(token, "redifinition of object entry `" + key + "'");
+        // Eat comma, if needed
+        if (ok && m_lex.seek().type() == Token::Comma)
+        {
+            m_lex.get();
+            continue;
+        }
+        if (ok && m_lex.seek().type() == Token::RightBrace)
+            break;
+        if (ok)
+            M_error(m_lex.seek(), "expected `}' at end of object declaration");
 
-        // Get the separator
-        if (m_lex.seek().type() != Token::Colon)
-            M_error(m_lex.seek(), "expected `:' after identifier");
+        if (!m_errors)
+        {
+            delete node;
+            return 0;
+        }
+        if (!M_resync())
+            break;
+    }
+
+    // Eat the closing } (which may be missing in recovery mode)
+    if (m_lex.seek().type() == Token::RightBrace)
         m_lex.get();
 
-        // Parse the object element value
-        node->impl()[key] = M_atom();
+    return node;
+}
 
-        // Eat comma, if needed
-        if (m_lex.seek().type() == Token::Comma)
-            m_lex.get();
-        else
-            break;
+//! Parse an object entry, returning false on errors.
+bool Parser::M_entry(ObjectNode* node)
+{
+    // Get key identifier
+    if (m_lex.seek().type() != Token::String)
+        return M_error(m_lex.seek(), "expected a identifier key");
+    Token token = m_lex.get();
+    std::string key = token.value();
+
+    if (node->exists(key))
+    {
+        std::size_t first = M_errors();
+        M_error(token, "redefinition of object entry `" + key + "'");
+        M_prefix(first, key);
+        return false;
     }
 
-    // Eat the closing }
-    if (m_lex.seek().type() != Token::RightBrace)
-        M_error(m_lex.seek(), "expected `}' at end of object declaration");
+    // Get the separator
+    if (m_lex.seek().type() != Token::Colon)
+        return M_error(m_lex.seek(), "expected `:' after identifier");
     m_lex.get();
 
-    return node;
+    // Parse the object element value
+    std::size_t first = M_errors();
+    Node* value = M_atom();
+    if (!value || M_errors() != first)
+        M_prefix(first, key);
+    if (!value)
+        return false;
+
+    node->impl()[key] = value;
+    return true;
 }
 
 Node* Parser::M_array()
 {
     // Eat the opening [
     if (m_lex.seek().type() != Token::LeftBracket)
-        M_error(m_lex.seek(), "expected `[' at beginning of array definition");
+        return M_error(m_lex.seek(), "expected `[' at beginning of array definition");
     m_lex.get();
 
-    // Create appropriate node
-    ArrayNode* node = new ArrayNode();
+    // Create appropriate node, packing arrays that start
+    //   with a number or a boolean
+    Token::Type first = m_lex.seek().type();
+    ArrayNode* node;
+    if (first == Token::Number)
+        node = new ArrayNode(ArrayNode::Numbers);
+    else if (first == Token::True || first == Token::False)
+        node = new ArrayNode(ArrayNode::Booleans);
+    else
+        node = new ArrayNode();
 
     // Parse array entries
     for (;;)
     {
+        Token::Type next = m_lex.seek().type();
+
         // Allow empty arrays
-        if (m_lex.seek().type() == Token::RightBracket)
+        if (next == Token::RightBracket)
             break;
 
-        // Get array element
-        node->impl().push_back(M_atom());
+        // Get array element, the array is unpacked by impl()
+        //   as soon as it turns out to be heterogeneous
+        bool ok = true;
+        double number;
+        if (node->storage() == ArrayNode::Numbers && next == Token::Number &&
+            toNumber(m_lex.seek().value(), number))
+        {
+            m_lex.get();
+            node->numbers().push_back(number);
+        }
+        else if (node->storage() == ArrayNode::Booleans && (next == Token::True || next == Token::False))
+            node->booleans().push_back(m_lex.get().type() == Token::True);
+        else
+        {
+            std::size_t errors = M_errors();
+            Node* value = M_atom();
+            if (!value || M_errors() != errors)
+                M_prefix(errors, node->size());
+            if (value)
+                node->impl().push_back(value);
+            else
+                ok = false;
+        }
 
         // Get comma, if needed
-        if (m_lex.seek().type() == Token::Comma)
+        if (ok && m_lex.seek().type() == Token::Comma)
+        {
             m_lex.get();
-        else
+            continue;
+        }
+        if (ok && m_lex.seek().type() == Token::RightBracket)
             break;
-    };
+        if (ok)
+            M_error(m_lex.seek(), "expected `]' at end of array declaration");
 
-    if (m_lex.seek().type() != Token::RightBracket)
-        M_error(m_lex.seek(), "expected `]' at end of array declaration");
-    m_lex.get();
+        if (!m_errors)
+        {
+            delete node;
+            return 0;
+        }
+        if (!M_resync())
+            break;
+    }
+
+    // Eat the closing ] (which may be missing in recovery mode)
+    if (m_lex.seek().type() == Token::RightBracket)
+        m_lex.get();
 
     return node;
 }
 
-void Parser::M_error(Token const& at, std::string const& msg)
+Node* Parser::M_error(Token const& at, std::string const& msg, Node* partial)
+{
+    std::size_t line, column;
+    m_lex.position(at.info().offset, line, column);
+    m_status->fail(line, column, msg);
+
+    // A mismatched closing brace or bracket is reported once, by the
+    //   innermost container
+    if (!m_errors || m_errors->empty() ||
+        m_errors->back().line != line || m_errors->back().column != column)
+        M_record();
+
+    delete partial;
+    return 0;
+}
+
+void Parser::M_record()
+{
+    if (m_errors)
+        m_errors->push_back(*m_status);
+}
+
+bool Parser::M_resync()
 {
-    std::ostringstream ss;
-    ss << "json::Parser::M_error: [" << at.info().line
-       << ":" << at.info().column << "]"
-       << ": " << msg;
+    // Nested objects and arrays are skipped as a whole
+    int depth = 0;
+    for (;;)
+    {
+        Token::Type type = m_lex.seek().type();
+        if (type == Token::Eof)
+            return false;
 
-    throw std::logic_error(ss.str());
+        if (depth == 0)
+        {
+            if (type == Token::RightBrace || type == Token::RightBracket)
+                return false;
+            if (type == Token::Comma)
+            {
+                m_lex.get();
+                return true;
+            }
+        }
+
+        if (type == Token::LeftBrace || type == Token::LeftBracket)
+            ++depth;
+        else if (type == Token::RightBrace || type == Token::RightBracket)
+            --depth;
+        m_lex.get();
+    }
+}
+
+std::size_t Parser::M_errors() const
+{ return m_errors ? m_errors->size() : 0; }
+
+void Parser::M_prefix(std::size_t first, std::string const& key)
+{
+    if (m_errors)
+        prefix(*m_errors, first, key);
+    else
+        m_status->prefix(key);
+}
+
+void Parser::M_prefix(std::size_t first, std::size_t index)
+{
+    if (m_errors)
+        prefix(*m_errors, first, index);
+    else
+        m_status->prefix(index);
 }
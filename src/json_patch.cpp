@@ -0,0 +1,591 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_patch.h"
+#include "lconf/json_path.h"
+#include "lconf/json_template.h"
+#include <stdexcept>
+#include <algorithm>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    //! Copy of the i-th element of an array.
+    Node* element(ArrayNode const* arr, std::size_t i)
+    {
+        if (arr->storage() == ArrayNode::Numbers)
+            return new NumberNode(arr->numbers()[i], arr->isSingle());
+        if (arr->storage() == ArrayNode::Booleans)
+            return new BooleanNode(arr->booleans()[i]);
+        return arr->at(i)->clone();
+    }
+
+    //! Build the operations turning a tree into another one.
+    class Differ
+    {
+    public:
+        Differ(ArrayNode* ops) :
+            m_ops(ops)
+        {}
+
+        void diff(Node const* a, Node const* b)
+        {
+            if (a == b)
+                return;
+
+            if (a->type() != b->type())
+            {
+                op("replace", b->clone());
+                return;
+            }
+
+            switch (a->type())
+            {
+                case Node::Number:
+                case Node::Boolean:
+                case Node::String:
+                    if (!equal(a, b))
+                        op("replace", b->clone());
+                    break;
+
+                // Subtrees with different (cached) hashes differ,
+                //   while equal hashes must be confirmed
+                case Node::Object:
+                    if (a->hash() != b->hash() || !equal(a, b))
+                        objects((ObjectNode const*) a, (ObjectNode const*) b);
+                    break;
+
+                case Node::Array:
+                    if (a->hash() != b->hash() || !equal(a, b))
+                        arrays((ArrayNode const*) a, (ArrayNode const*) b);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+    private:
+        void objects(ObjectNode const* a, ObjectNode const* b)
+        {
+            std::map<std::string, Node*> const& ia = a->impl();
+            std::map<std::string, Node*> const& ib = b->impl();
+            std::map<std::string, Node*>::const_iterator ita = ia.begin(), itb = ib.begin();
+            std::size_t size = m_path.size();
+
+            while (ita != ia.end() || itb != ib.end())
+            {
+                if (itb == ib.end() || (ita != ia.end() && ita->first < itb->first))
+                {
+                    m_path += '/' + Path::escape(ita->first);
+                    op("remove", 0);
+                    ++ita;
+                }
+                else if (ita == ia.end() || itb->first < ita->first)
+                {
+                    m_path += '/' + Path::escape(itb->first);
+                    op("add", itb->second->clone());
+                    ++itb;
+                }
+                else
+                {
+                    m_path += '/' + Path::escape(ita->first);
+                    diff(ita->second, itb->second);
+                    ++ita, ++itb;
+                }
+                m_path.resize(size);
+            }
+        }
+
+        void arrays(ArrayNode const* a, ArrayNode const* b)
+        {
+            std::size_t na = a->size(), nb = b->size();
+            std::size_t common = std::min(na, nb);
+            std::size_t size = m_path.size();
+
+            // Packed arrays are compared value by value, without unpacking them
+            bool numbers = a->storage() == ArrayNode::Numbers && b->storage() == ArrayNode::Numbers;
+            bool booleans = a->storage() == ArrayNode::Booleans && b->storage() == ArrayNode::Booleans;
+
+            for (std::size_t i = 0; i < common; ++i)
+            {
+                m_path += '/' + std::to_string(i);
+                if (numbers)
+                {
+                    if (a->numbers()[i] != b->numbers()[i])
+                        op("replace", element(b, i));
+                }
+                else if (booleans)
+                {
+                    if (a->booleans()[i] != b->booleans()[i])
+                        op("replace", element(b, i));
+                }
+                else
+                    diff(a->at(i), b->at(i));
+                m_path.resize(size);
+            }
+
+            for (std::size_t i = common; i < nb; ++i)
+            {
+                m_path += '/' + std::to_string(i);
+                op("add", element(b, i));
+                m_path.resize(size);
+            }
+
+            // Remove trailing elements from the end, so that indices stay valid
+            for (std::size_t i = na; i > common; --i)
+            {
+                m_path += '/' + std::to_string(i - 1);
+                op("remove", 0);
+                m_path.resize(size);
+            }
+        }
+
+        //! Append an operation on the current path, taking
+        //!   ownership of value (if any).
+        void op(char const* name, Node* value)
+        {
+            ObjectNode* obj = new ObjectNode();
+            m_ops->impl().push_back(obj);
+
+            std::map<std::string, Node*>& impl = obj->impl();
+            if (value)
+                impl["value"] = value;
+            impl["op"] = new StringNode(name);
+            impl["path"] = new StringNode(m_path);
+        }
+
+    private:
+        ArrayNode* m_ops;
+        std::string m_path;
+    };
+
+    //! Apply the operations of a patch.
+    //! Operations replacing the whole document work on a new root, the
+    //!   original one being released on commit() only, so that it stays
+    //!   valid if a later operation fails.
+    class Patcher
+    {
+    public:
+        Patcher(Node* root) :
+            m_root(root),
+            m_original(root),
+            m_op(0)
+        {}
+
+        //! Get the patched root, releasing the original one if replaced.
+        Node* commit()
+        {
+            if (m_root != m_original)
+                Node::release(m_original);
+            m_original = m_root;
+            return m_root;
+        }
+
+        //! Release the root created by the patch, if any.
+        void rollback()
+        {
+            if (m_root != m_original)
+                Node::release(m_root);
+            m_root = m_original;
+        }
+
+        void apply(Node const* op)
+        {
+            m_op = op;
+            if (op->type() != Node::Object)
+                M_error("operation is not an object");
+
+            std::string name = member("op");
+            Path path = pointer("path");
+
+            if (name == "add")
+                insert(path, value()->clone());
+            else if (name == "remove")
+                Node::release(remove(path));
+            else if (name == "replace")
+            {
+                Node* replaced = value()->clone();
+                if (!path.size())
+                {
+                    setRoot(replaced);
+                    return;
+                }
+
+                Node* old = 0;
+                try
+                {
+                    old = remove(path);
+                    add(path, replaced);
+                }
+                catch (...)
+                {
+                    delete replaced;
+                    if (old)
+                        restore(path, old);
+                    throw;
+                }
+                Node::release(old);
+            }
+            else if (name == "move")
+            {
+                Path from = pointer("from");
+                if (from.str() == path.str())
+                    return;
+                if (path.str().compare(0, from.str().size() + 1, from.str() + "/") == 0)
+                    M_error("can not move a value into itself");
+
+                Node* moved = remove(from);
+                try
+                {
+                    add(path, moved);
+                }
+                catch (...)
+                {
+                    restore(from, moved);
+                    throw;
+                }
+            }
+            else if (name == "copy")
+            {
+                Path from = pointer("from");
+                insert(path, resolve(from, from.size())->clone());
+            }
+            else if (name == "test")
+            {
+                if (!equal(resolve(path, path.size()), value()))
+                    M_error("test failed for \"" + path.str() + "\"");
+            }
+            else
+                M_error("unknown operation \"" + name + "\"");
+        }
+
+    private:
+        std::string member(std::string const& key)
+        {
+            std::map<std::string, Node*> const& impl = ((ObjectNode const*) m_op)->impl();
+            std::map<std::string, Node*>::const_iterator it = impl.find(key);
+            if (it == impl.end() || it->second->type() != Node::String)
+                M_error("missing string member \"" + key + "\"");
+            return ((StringNode const*) it->second)->value();
+        }
+
+        Path pointer(std::string const& key)
+        {
+            std::string expr = member(key);
+            try
+            {
+                return Path(expr, false);
+            }
+            catch (std::logic_error const& exc)
+            {
+                M_error(exc.what());
+            }
+            return Path();
+        }
+
+        Node const* value()
+        {
+            std::map<std::string, Node*> const& impl = ((ObjectNode const*) m_op)->impl();
+            std::map<std::string, Node*>::const_iterator it = impl.find("value");
+            if (it == impl.end())
+                M_error("missing member \"value\"");
+            return it->second;
+        }
+
+        //! Get the node at the first count segments of path.
+        Node* resolve(Path const& path, std::size_t count)
+        {
+            Node* node = m_root;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (ObjectNode const* obj = node->downcast<ObjectNode>())
+                {
+                    std::map<std::string, Node*> const& impl = obj->impl();
+                    std::map<std::string, Node*>::const_iterator it = impl.find(path.key(i));
+                    if (it == impl.end())
+                        M_error("no such value \"" + path.str() + "\"");
+                    node = it->second;
+                }
+                else if (ArrayNode const* arr = node->downcast<ArrayNode>())
+                {
+                    if (!path.isIndex(i) || path.index(i) >= arr->size())
+                        M_error("no such value \"" + path.str() + "\"");
+                    node = arr->at(path.index(i));
+                }
+                else
+                    M_error("no such value \"" + path.str() + "\"");
+            }
+            return node;
+        }
+
+        //! Replace the root, releasing the previous one
+        //!   unless it is the original root.
+        void setRoot(Node* root)
+        {
+            if (m_root != m_original)
+                Node::release(m_root);
+            m_root = root;
+        }
+
+        //! Insert value at path, taking ownership of it
+        //!   (and releasing it on failure).
+        void insert(Path const& path, Node* value)
+        {
+            try
+            {
+                add(path, value);
+            }
+            catch (...)
+            {
+                Node::release(value);
+                throw;
+            }
+        }
+
+        //! Insert value at path, taking ownership of it on success only.
+        void add(Path const& path, Node* value)
+        {
+            if (!path.size())
+            {
+                setRoot(value);
+                return;
+            }
+
+            std::size_t last = path.size() - 1;
+            Node* parent = resolve(path, last);
+
+            if (ObjectNode* obj = parent->downcast<ObjectNode>())
+            {
+                std::map<std::string, Node*>& impl = obj->impl();
+                std::map<std::string, Node*>::iterator it = impl.lower_bound(path.key(last));
+                if (it != impl.end() && it->first == path.key(last))
+                {
+                    Node::release(it->second);
+                    it->second = value;
+                }
+                else
+                    impl.insert(it, std::make_pair(path.key(last), value));
+            }
+            else if (ArrayNode* arr = parent->downcast<ArrayNode>())
+            {
+                if (path.key(last) != "-" && (!path.isIndex(last) || path.index(last) > arr->size()))
+                    M_error("bad array index \"" + path.str() + "\"");
+
+                std::vector<Node*>& impl = arr->impl();
+                if (path.key(last) == "-")
+                    impl.push_back(value);
+                else
+                    impl.insert(impl.begin() + path.index(last), value);
+            }
+            else
+                M_error("no such container \"" + path.str() + "\"");
+        }
+
+        //! Put back a value detached by remove(), releasing it if
+        //!   that fails too.
+        void restore(Path const& path, Node* value)
+        {
+            try
+            {
+                add(path, value);
+            }
+            catch (...)
+            {
+                Node::release(value);
+            }
+        }
+
+        //! Detach the value at path from the tree.
+        Node* remove(Path const& path)
+        {
+            if (!path.size())
+                M_error("can not remove the whole document");
+
+            std::size_t last = path.size() - 1;
+            Node* parent = resolve(path, last);
+            Node* node = 0;
+
+            if (ObjectNode* obj = parent->downcast<ObjectNode>())
+            {
+                std::map<std::string, Node*>& impl = obj->impl();
+                std::map<std::string, Node*>::iterator it = impl.find(path.key(last));
+                if (it == impl.end())
+                    M_error("no such value \"" + path.str() + "\"");
+                node = it->second;
+                impl.erase(it);
+            }
+            else if (ArrayNode* arr = parent->downcast<ArrayNode>())
+            {
+                std::vector<Node*>& impl = arr->impl();
+                if (!path.isIndex(last) || path.index(last) >= impl.size())
+                    M_error("no such value \"" + path.str() + "\"");
+                node = impl[path.index(last)];
+                impl.erase(impl.begin() + path.index(last));
+            }
+            else
+                M_error("no such value \"" + path.str() + "\"");
+
+            return node;
+        }
+
+        void M_error(std::string const& msg)
+        {
+            throw Exception(const_cast<Node*>(m_op), "json::patch: " + msg);
+        }
+
+    private:
+        Node* m_root;
+        Node* m_original;
+        Node const* m_op;
+    };
+
+    Node* merge(Node* node, Node const* patch)
+    {
+        if (patch->type() != Node::Object)
+        {
+            Node* value = patch->clone();
+            Node::release(node);
+            return value;
+        }
+
+        ObjectNode* target = node ? node->downcast<ObjectNode>() : 0;
+        if (!target)
+        {
+            Node::release(node);
+            target = new ObjectNode();
+        }
+
+        std::map<std::string, Node*>& impl = target->impl();
+        std::map<std::string, Node*> const& entries = ((ObjectNode const*) patch)->impl();
+        for (std::map<std::string, Node*>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            std::map<std::string, Node*>::iterator found = impl.find(it->first);
+            if (it->second->type() == Node::Null)
+            {
+                if (found != impl.end())
+                {
+                    Node::release(found->second);
+                    impl.erase(found);
+                }
+            }
+            else if (found != impl.end())
+                found->second = merge(found->second, it->second);
+            else
+                impl[it->first] = merge(0, it->second);
+        }
+        return target;
+    }
+}
+
+namespace lconf { namespace json
+{
+    Node* diff(Node const* from, Node const* to)
+    {
+        ArrayNode* ops = new ArrayNode();
+        try
+        {
+            Differ differ(ops);
+            differ.diff(from, to);
+        }
+        catch (...)
+        {
+            delete ops;
+            throw;
+        }
+        return ops;
+    }
+
+    Node* patch(Node* node, Node const* ops)
+    {
+        if (ops->type() != Node::Array)
+            throw Exception(const_cast<Node*>(ops), "json::patch: patch is not an array");
+
+        ArrayNode const* arr = (ArrayNode const*) ops;
+        Patcher patcher(node);
+        try
+        {
+            for (std::size_t i = 0; i < arr->size(); ++i)
+                patcher.apply(arr->at(i));
+        }
+        catch (...)
+        {
+            patcher.rollback();
+            throw;
+        }
+        return patcher.commit();
+    }
+
+    Node* mergeDiff(Node const* from, Node const* to)
+    {
+        if (from->type() != Node::Object || to->type() != Node::Object)
+            return to->clone();
+
+        std::map<std::string, Node*> const& ia = ((ObjectNode const*) from)->impl();
+        std::map<std::string, Node*> const& ib = ((ObjectNode const*) to)->impl();
+        std::map<std::string, Node*>::const_iterator ita = ia.begin(), itb = ib.begin();
+
+        ObjectNode* obj = new ObjectNode();
+        try
+        {
+            std::map<std::string, Node*>& impl = obj->impl();
+            while (ita != ia.end() || itb != ib.end())
+            {
+                if (itb == ib.end() || (ita != ia.end() && ita->first < itb->first))
+                {
+                    impl.insert(impl.end(), std::make_pair(ita->first, (Node*) new NullNode()));
+                    ++ita;
+                }
+                else if (ita == ia.end() || itb->first < ita->first)
+                {
+                    impl.insert(impl.end(), std::make_pair(itb->first, itb->second->clone()));
+                    ++itb;
+                }
+                else
+                {
+                    if (ita->second->hash() == itb->second->hash() && equal(ita->second, itb->second))
+                    {}
+                    else if (ita->second->type() == Node::Object && itb->second->type() == Node::Object)
+                    {
+                        Node* sub = mergeDiff(ita->second, itb->second);
+                        if (((ObjectNode*) sub)->impl().empty())
+                            delete sub;
+                        else
+                            impl.insert(impl.end(), std::make_pair(ita->first, sub));
+                    }
+                    else
+                        impl.insert(impl.end(), std::make_pair(ita->first, itb->second->clone()));
+                    ++ita, ++itb;
+                }
+            }
+        }
+        catch (...)
+        {
+            delete obj;
+            throw;
+        }
+        return obj;
+    }
+
+    Node* mergePatch(Node* node, Node const* patch)
+    {
+        return merge(node, patch);
+    }
+} }
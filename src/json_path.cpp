@@ -0,0 +1,326 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_path.h"
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    //! Undo the "~0" and "~1" escapes of a pointer segment.
+    std::string unescape(std::string const& expr, std::string const& segment)
+    {
+        std::string key;
+        key.reserve(segment.size());
+        for (std::size_t i = 0; i < segment.size(); ++i)
+        {
+            if (segment[i] != '~')
+                key += segment[i];
+            else if (i + 1 < segment.size() && segment[i + 1] == '0')
+                key += '~', ++i;
+            else if (i + 1 < segment.size() && segment[i + 1] == '1')
+                key += '/', ++i;
+            else
+                throw std::logic_error("json::Path: bad escape sequence in \"" + expr + "\"");
+        }
+        return key;
+    }
+
+    //! Array indices are "0" or digits without leading zeros.
+    bool parseIndex(std::string const& key, std::size_t& index)
+    {
+        if (key.empty() || key.size() > 18 || (key[0] == '0' && key.size() > 1))
+            return false;
+
+        index = 0;
+        for (std::size_t i = 0; i < key.size(); ++i)
+        {
+            if (key[i] < '0' || key[i] > '9')
+                return false;
+            index = index * 10 + (key[i] - '0');
+        }
+        return true;
+    }
+}
+
+Path::Path() :
+    m_pointer(true)
+{}
+
+Path::Path(std::string const& expr, bool extended) :
+    m_expr(expr),
+    m_pointer(true)
+{
+    if (expr.empty())
+        return;
+    if (expr[0] != '/')
+        throw std::logic_error("json::Path: \"" + expr + "\" does not start with `/'");
+
+    std::size_t begin = 1;
+    for (;;)
+    {
+        std::size_t end = expr.find('/', begin);
+        if (end == std::string::npos)
+        {
+            M_compile(expr.substr(begin), extended);
+            break;
+        }
+        M_compile(expr.substr(begin, end - begin), extended);
+        begin = end + 1;
+    }
+}
+
+Node* Path::find(Node* root) const
+{
+    std::vector<Node*> out;
+    M_select(root, 0, out, true);
+    return out.empty() ? 0 : out[0];
+}
+
+void Path::select(Node* root, std::vector<Node*>& out) const
+{
+    M_select(root, 0, out, false);
+}
+
+std::vector<Node*> Path::select(Node* root) const
+{
+    std::vector<Node*> out;
+    M_select(root, 0, out, false);
+    return out;
+}
+
+bool Path::isPointer() const
+{
+    return m_pointer;
+}
+
+std::string const& Path::str() const
+{
+    return m_expr;
+}
+
+std::size_t Path::size() const
+{
+    return m_steps.size();
+}
+
+std::string const& Path::key(std::size_t i) const
+{
+    return m_steps.at(i).key;
+}
+
+bool Path::isIndex(std::size_t i) const
+{
+    return m_steps.at(i).isIndex;
+}
+
+std::size_t Path::index(std::size_t i) const
+{
+    return m_steps.at(i).index;
+}
+
+std::string Path::escape(std::string const& key)
+{
+    std::string segment;
+    segment.reserve(key.size());
+    for (std::size_t i = 0; i < key.size(); ++i)
+    {
+        if (key[i] == '~')
+            segment += "~0";
+        else if (key[i] == '/')
+            segment += "~1";
+        else
+            segment += key[i];
+    }
+    return segment;
+}
+
+void Path::M_compile(std::string const& segment, bool extended)
+{
+    Step step;
+    step.kind = Step::Key;
+    step.isIndex = false;
+    step.index = 0;
+    step.type = Node::String;
+    step.number = 0;
+    step.boolean = false;
+
+    if (extended && segment == "*")
+        step.kind = Step::Wildcard;
+    else if (extended && segment == "**")
+        step.kind = Step::Descendants;
+    else if (extended && !segment.empty() && segment[0] == '?')
+    {
+        std::size_t eq = segment.find('=');
+        if (eq == std::string::npos || eq == 1)
+            throw std::logic_error("json::Path: bad filter in \"" + m_expr + "\"");
+
+        step.kind = Step::Filter;
+        step.key = unescape(m_expr, segment.substr(1, eq - 1));
+
+        std::string literal = unescape(m_expr, segment.substr(eq + 1));
+        char* end = 0;
+        double number = std::strtod(literal.c_str(), &end);
+        if (literal == "null")
+            step.type = Node::Null;
+        else if (literal == "true" || literal == "false")
+        {
+            step.type = Node::Boolean;
+            step.boolean = literal == "true";
+        }
+        else if (literal.size() >= 2 && literal[0] == '"' && literal[literal.size() - 1] == '"')
+            step.string = literal.substr(1, literal.size() - 2);
+        else if (!literal.empty() && *end == '\0')
+        {
+            step.type = Node::Number;
+            step.number = number;
+        }
+        else
+            step.string = literal;
+    }
+    else
+    {
+        step.key = unescape(m_expr, segment);
+        step.isIndex = parseIndex(step.key, step.index);
+    }
+
+    if (step.kind != Step::Key)
+        m_pointer = false;
+    m_steps.push_back(step);
+}
+
+bool Path::M_select(Node* node, std::size_t step, std::vector<Node*>& out, bool first) const
+{
+    // Entries created by ObjectNode::get() may not be set yet
+    if (!node)
+        return false;
+
+    if (step == m_steps.size())
+    {
+        out.push_back(node);
+        return first;
+    }
+
+    Step const& s = m_steps[step];
+    switch (s.kind)
+    {
+        case Step::Key:
+            if (ObjectNode const* obj = node->downcast<ObjectNode>())
+            {
+                std::map<std::string, Node*> const& impl = obj->impl();
+                std::map<std::string, Node*>::const_iterator it = impl.find(s.key);
+                return it != impl.end() && M_select(it->second, step + 1, out, first);
+            }
+            else if (ArrayNode const* arr = node->downcast<ArrayNode>())
+                return s.isIndex && s.index < arr->size() &&
+                    M_select(arr->at(s.index), step + 1, out, first);
+            return false;
+
+        case Step::Wildcard:
+        case Step::Filter:
+            return M_children(node, step, out, first);
+
+        case Step::Descendants:
+            return M_descendants(node, step + 1, out, first);
+    }
+    return false;
+}
+
+bool Path::M_children(Node* node, std::size_t step, std::vector<Node*>& out, bool first) const
+{
+    Step const& s = m_steps[step];
+
+    if (ObjectNode const* obj = node->downcast<ObjectNode>())
+    {
+        std::map<std::string, Node*> const& impl = obj->impl();
+        for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+        {
+            if (s.kind == Step::Filter && !M_matches(it->second, s))
+                continue;
+            if (M_select(it->second, step + 1, out, first))
+                return true;
+        }
+    }
+    else if (ArrayNode const* arr = node->downcast<ArrayNode>())
+    {
+        // Elements of packed arrays are never objects
+        if (s.kind == Step::Filter && arr->storage() != ArrayNode::Generic)
+            return false;
+
+        for (std::size_t i = 0; i < arr->size(); ++i)
+        {
+            if (s.kind == Step::Filter && !M_matches(arr->at(i), s))
+                continue;
+            if (M_select(arr->at(i), step + 1, out, first))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool Path::M_descendants(Node* node, std::size_t step, std::vector<Node*>& out, bool first) const
+{
+    if (!node)
+        return false;
+    if (M_select(node, step, out, first))
+        return true;
+
+    if (ObjectNode const* obj = node->downcast<ObjectNode>())
+    {
+        std::map<std::string, Node*> const& impl = obj->impl();
+        for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+            if (M_descendants(it->second, step, out, first))
+                return true;
+    }
+    else if (ArrayNode const* arr = node->downcast<ArrayNode>())
+    {
+        for (std::size_t i = 0; i < arr->size(); ++i)
+            if (M_descendants(arr->at(i), step, out, first))
+                return true;
+    }
+    return false;
+}
+
+bool Path::M_matches(Node* node, Step const& filter) const
+{
+    ObjectNode const* obj = node ? node->downcast<ObjectNode>() : 0;
+    if (!obj)
+        return false;
+
+    std::map<std::string, Node*> const& impl = obj->impl();
+    std::map<std::string, Node*>::const_iterator it = impl.find(filter.key);
+    if (it == impl.end() || !it->second || it->second->type() != filter.type)
+        return false;
+
+    switch (filter.type)
+    {
+        case Node::Number:
+            return ((NumberNode*) it->second)->value() == filter.number;
+        case Node::Boolean:
+            return ((BooleanNode*) it->second)->value() == filter.boolean;
+        case Node::String:
+            return ((StringNode*) it->second)->value() == filter.string;
+        case Node::Null:
+            return true;
+        default:
+            return false;
+    }
+}
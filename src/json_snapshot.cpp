@@ -0,0 +1,582 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_snapshot.h"
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    //! Snapshot header, at offset 0.
+    struct Header
+    {
+        char magic[4];
+        //! Written as 0x01020304 in the host byte order.
+        uint32_t endianness;
+        uint64_t size;
+        Slot root;
+    };
+
+    //! Object entry, objects point to arrays of entries sorted by key.
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t keySize;
+        uint32_t reserved;
+        Slot value;
+    };
+
+    char const magic[4] = { 'L', 'C', 'M', '1' };
+    uint32_t const endianness = 0x01020304;
+
+    //! Nesting depth of snapshots, so that corrupted offsets (which
+    //!   may even form cycles) can not exhaust the stack.
+    unsigned int const maxDepth = 1024;
+
+    //! Compare a key of the snapshot with str, like std::string does
+    //!   (so that std::map keys are stored in order).
+    int compareKey(char const* key, std::size_t size, std::string const& str)
+    {
+        int cmp = std::memcmp(key, str.data(), std::min(size, str.size()));
+        if (cmp)
+            return cmp;
+        return size < str.size() ? -1 : size > str.size() ? 1 : 0;
+    }
+
+    //! Builds a snapshot in memory.
+    //! Containers first reserve their slots or entries, which are
+    //!   filled as their children are appended after them.
+    class Compiler
+    {
+    public:
+        Compiler() :
+            m_depth(0)
+        {
+            m_data.resize(sizeof(Header));
+        }
+
+        std::string& finish(Node const* node)
+        {
+            Slot root = slot(node);
+
+            Header header;
+            std::memcpy(header.magic, magic, 4);
+            header.endianness = endianness;
+            header.size = m_data.size();
+            header.root = root;
+            std::memcpy(&m_data[0], &header, sizeof(Header));
+            return m_data;
+        }
+
+    private:
+        Slot slot(Node const* node)
+        {
+            Slot slot;
+            std::memset(&slot, 0, sizeof(Slot));
+
+            if (m_depth > maxDepth)
+                throw std::logic_error("json::Snapshot::write: values are nested too deeply");
+            Depth depth(m_depth);
+
+            switch (node->type())
+            {
+                case Node::Number:
+                {
+                    NumberNode const* num = (NumberNode const*) node;
+                    slot.kind = Slot::Number;
+                    slot.single = num->isSingle();
+                    slot.number = num->value();
+                    break;
+                }
+
+                case Node::Boolean:
+                    slot.kind = Slot::Boolean;
+                    slot.offset = ((BooleanNode const*) node)->value();
+                    break;
+
+                case Node::String:
+                {
+                    std::string const& str = ((StringNode const*) node)->value();
+                    slot.kind = Slot::String;
+                    slot.count = M_count(str.size());
+                    slot.offset = string(str);
+                    break;
+                }
+
+                case Node::Object:
+                {
+                    std::map<std::string, Node*> const& impl = ((ObjectNode const*) node)->impl();
+                    slot.kind = Slot::Object;
+                    slot.count = M_count(impl.size());
+                    slot.offset = reserve(impl.size() * sizeof(Entry));
+
+                    std::size_t i = 0;
+                    for (std::map<std::string, Node*>::const_iterator it = impl.begin();
+                         it != impl.end(); ++it, ++i)
+                    {
+                        Entry entry;
+                        std::memset(&entry, 0, sizeof(Entry));
+                        entry.keySize = M_count(it->first.size());
+                        entry.key = string(it->first);
+                        entry.value = this->slot(it->second);
+                        std::memcpy(&m_data[slot.offset + i * sizeof(Entry)], &entry, sizeof(Entry));
+                    }
+                    break;
+                }
+
+                case Node::Array:
+                    array((ArrayNode const*) node, slot);
+                    break;
+
+                case Node::Null:
+                    slot.kind = Slot::Null;
+                    break;
+            }
+
+            return slot;
+        }
+
+        void array(ArrayNode const* arr, Slot& slot)
+        {
+            if (arr->storage() == ArrayNode::Numbers)
+            {
+                std::vector<double> const& values = arr->numbers();
+                slot.kind = Slot::Numbers;
+                slot.single = arr->isSingle();
+                slot.count = M_count(values.size());
+                slot.offset = reserve(values.size() * sizeof(double));
+                if (!values.empty())
+                    std::memcpy(&m_data[slot.offset], &values[0], values.size() * sizeof(double));
+            }
+            else if (arr->storage() == ArrayNode::Booleans)
+            {
+                std::vector<bool> const& values = arr->booleans();
+                slot.kind = Slot::Booleans;
+                slot.count = M_count(values.size());
+                slot.offset = reserve(values.size());
+                for (std::size_t i = 0; i < values.size(); ++i)
+                    m_data[slot.offset + i] = values[i];
+            }
+            else
+            {
+                std::vector<Node*> const& impl = arr->impl();
+                slot.kind = Slot::Array;
+                slot.count = M_count(impl.size());
+                slot.offset = reserve(impl.size() * sizeof(Slot));
+                for (std::size_t i = 0; i < impl.size(); ++i)
+                {
+                    Slot child = this->slot(impl[i]);
+                    std::memcpy(&m_data[slot.offset + i * sizeof(Slot)], &child, sizeof(Slot));
+                }
+            }
+        }
+
+        //! Append a null terminated string, returning its offset.
+        uint64_t string(std::string const& str)
+        {
+            uint64_t offset = m_data.size();
+            m_data.append(str.data(), str.size());
+            m_data += '\0';
+            return offset;
+        }
+
+        //! Append size zero bytes, 8 bytes aligned, returning their offset.
+        uint64_t reserve(std::size_t size)
+        {
+            m_data.resize((m_data.size() + 7) & ~(std::size_t) 7);
+            uint64_t offset = m_data.size();
+            m_data.resize(m_data.size() + size);
+            return offset;
+        }
+
+        uint32_t M_count(std::size_t count)
+        {
+            if (count > UINT32_MAX)
+                throw std::logic_error("json::Snapshot::write: too many elements");
+            return count;
+        }
+
+        //! Nesting level of the value being compiled, for
+        //!   the scope of an instance.
+        struct Depth
+        {
+            Depth(unsigned int& depth) :
+                depth(++depth)
+            {}
+
+            ~Depth()
+            { --depth; }
+
+            unsigned int& depth;
+        };
+
+    private:
+        std::string m_data;
+        unsigned int m_depth;
+    };
+}
+
+View::View() :
+    m_base(0),
+    m_size(0),
+    m_depth(0)
+{
+    std::memset(&m_slot, 0, sizeof(Slot));
+    m_slot.kind = Slot::Boolean;
+}
+
+View::View(char const* base, std::size_t size, Slot const& slot) :
+    m_base(base),
+    m_size(size),
+    m_slot(slot),
+    m_depth(0)
+{}
+
+Node::Type View::type() const
+{
+    switch (m_slot.kind)
+    {
+        case Slot::Number:
+            return Node::Number;
+        case Slot::Boolean:
+            return Node::Boolean;
+        case Slot::String:
+            return Node::String;
+        case Slot::Object:
+            return Node::Object;
+        case Slot::Null:
+            return Node::Null;
+        default:
+            return Node::Array;
+    }
+}
+
+double View::number() const
+{
+    if (m_slot.kind != Slot::Number)
+        throw std::logic_error("json::View::number: not a number");
+    return m_slot.number;
+}
+
+bool View::isSingle() const
+{ return m_slot.single; }
+
+bool View::boolean() const
+{
+    if (m_slot.kind != Slot::Boolean)
+        throw std::logic_error("json::View::boolean: not a boolean");
+    return m_slot.offset;
+}
+
+char const* View::string() const
+{
+    if (m_slot.kind != Slot::String)
+        throw std::logic_error("json::View::string: not a string");
+    return M_data<char>(m_slot.count + 1);
+}
+
+std::size_t View::size() const
+{ return m_slot.kind == Slot::Number || m_slot.kind == Slot::Boolean || m_slot.kind == Slot::Null ? 0 : m_slot.count; }
+
+std::string View::key(std::size_t i) const
+{
+    if (m_slot.kind != Slot::Object)
+        throw std::logic_error("json::View::key: not an object");
+    if (i >= m_slot.count)
+        throw std::out_of_range("json::View::key: index out of range");
+
+    Entry const& entry = M_data<Entry>(m_slot.count)[i];
+    if (entry.keySize > m_size || entry.key > m_size - entry.keySize)
+        throw std::logic_error("json::View: corrupted snapshot");
+    return std::string(m_base + entry.key, entry.keySize);
+}
+
+bool View::exists(std::string const& key) const
+{
+    View value;
+    return find(key, value);
+}
+
+bool View::find(std::string const& key, View& value) const
+{
+    if (m_slot.kind != Slot::Object)
+        throw std::logic_error("json::View::find: not an object");
+
+    Entry const* entries = M_data<Entry>(m_slot.count);
+    std::size_t lo = 0, hi = m_slot.count;
+    while (lo < hi)
+    {
+        std::size_t mid = lo + (hi - lo) / 2;
+        Entry const& entry = entries[mid];
+        if (entry.keySize > m_size || entry.key > m_size - entry.keySize)
+            throw std::logic_error("json::View: corrupted snapshot");
+
+        int cmp = compareKey(m_base + entry.key, entry.keySize, key);
+        if (cmp < 0)
+            lo = mid + 1;
+        else if (cmp > 0)
+            hi = mid;
+        else
+        {
+            value = M_child(entry.value);
+            return true;
+        }
+    }
+    return false;
+}
+
+View View::get(std::string const& key) const
+{
+    View value;
+    if (!find(key, value))
+        throw std::out_of_range("json::View::get: no such key `" + key + "'");
+    return value;
+}
+
+View View::at(std::size_t i) const
+{
+    if (i >= size() || m_slot.kind == Slot::String)
+        throw std::out_of_range("json::View::at: index out of range");
+
+    Slot slot;
+    std::memset(&slot, 0, sizeof(Slot));
+
+    switch (m_slot.kind)
+    {
+        case Slot::Object:
+            return M_child(M_data<Entry>(m_slot.count)[i].value);
+        case Slot::Array:
+            return M_child(M_data<Slot>(m_slot.count)[i]);
+        case Slot::Numbers:
+            slot.kind = Slot::Number;
+            slot.single = m_slot.single;
+            slot.number = M_data<double>(m_slot.count)[i];
+            break;
+        default:
+            slot.kind = Slot::Boolean;
+            slot.offset = M_data<uint8_t>(m_slot.count)[i];
+            break;
+    }
+    return M_child(slot);
+}
+
+double const* View::numbers() const
+{
+    if (m_slot.kind != Slot::Numbers)
+        return 0;
+    return M_data<double>(m_slot.count);
+}
+
+uint8_t const* View::booleans() const
+{
+    if (m_slot.kind != Slot::Booleans)
+        return 0;
+    return M_data<uint8_t>(m_slot.count);
+}
+
+Node* View::materialize() const
+{
+    switch (m_slot.kind)
+    {
+        case Slot::Number:
+            return new NumberNode(m_slot.number, m_slot.single);
+
+        case Slot::Boolean:
+            return new BooleanNode(m_slot.offset);
+
+        case Slot::Null:
+            return new NullNode();
+
+        case Slot::String:
+            return new StringNode(std::string(string(), m_slot.count));
+
+        case Slot::Object:
+        {
+            ObjectNode* obj = new ObjectNode();
+            try
+            {
+                std::map<std::string, Node*>& impl = obj->impl();
+                for (std::size_t i = 0; i < m_slot.count; ++i)
+                    impl.insert(impl.end(), std::make_pair(key(i), at(i).materialize()));
+            }
+            catch (...)
+            {
+                delete obj;
+                throw;
+            }
+            return obj;
+        }
+
+        case Slot::Array:
+        {
+            ArrayNode* arr = new ArrayNode();
+            try
+            {
+                std::vector<Node*>& impl = arr->impl();
+                impl.reserve(m_slot.count);
+                for (std::size_t i = 0; i < m_slot.count; ++i)
+                    impl.push_back(at(i).materialize());
+            }
+            catch (...)
+            {
+                delete arr;
+                throw;
+            }
+            return arr;
+        }
+
+        case Slot::Numbers:
+        {
+            double const* values = numbers();
+            ArrayNode* arr = new ArrayNode(ArrayNode::Numbers);
+            arr->setSingle(m_slot.single);
+            arr->numbers().assign(values, values + m_slot.count);
+            return arr;
+        }
+
+        case Slot::Booleans:
+        {
+            uint8_t const* values = booleans();
+            ArrayNode* arr = new ArrayNode(ArrayNode::Booleans);
+            arr->booleans().assign(values, values + m_slot.count);
+            return arr;
+        }
+
+        default:
+            throw std::logic_error("json::View: corrupted snapshot");
+    }
+}
+
+//! View a child of the viewed value.
+View View::M_child(Slot const& slot) const
+{
+    if (m_depth >= maxDepth)
+        throw std::logic_error("json::View: corrupted snapshot");
+
+    View child(m_base, m_size, slot);
+    child.m_depth = m_depth + 1;
+    return child;
+}
+
+//! Get the contents of the viewed value, checking that count
+//!   elements fit in the snapshot.
+template <typename T>
+T const* View::M_data(std::size_t count) const
+{
+    // Offsets are checked for alignment too, the data being read in place
+    if (m_slot.offset > m_size || count > (m_size - m_slot.offset) / sizeof(T) ||
+        m_slot.offset % alignof(T))
+        throw std::logic_error("json::View: corrupted snapshot");
+    return (T const*) (m_base + m_slot.offset);
+}
+
+Snapshot::Snapshot(std::string const& file) :
+    m_data(0),
+    m_size(0),
+    m_mapped(true)
+{
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::logic_error("json::Snapshot: unable to open \"" + file + "\"");
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(Header))
+    {
+        ::close(fd);
+        throw std::logic_error("json::Snapshot: invalid snapshot \"" + file + "\"");
+    }
+
+    void* data = ::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::logic_error("json::Snapshot: unable to map \"" + file + "\"");
+
+    m_data = (char const*) data;
+    m_size = st.st_size;
+
+    try
+    {
+        M_check();
+    }
+    catch (...)
+    {
+        ::munmap((void*) m_data, m_size);
+        throw;
+    }
+}
+
+Snapshot::Snapshot(void const* data, std::size_t size) :
+    m_data((char const*) data),
+    m_size(size),
+    m_mapped(false)
+{ M_check(); }
+
+Snapshot::~Snapshot()
+{
+    if (m_mapped)
+        ::munmap((void*) m_data, m_size);
+}
+
+View Snapshot::root() const
+{
+    Header const* header = (Header const*) m_data;
+    return View(m_data, m_size, header->root);
+}
+
+char const* Snapshot::data() const
+{ return m_data; }
+
+std::size_t Snapshot::size() const
+{ return m_size; }
+
+void Snapshot::write(Node const* node, std::ostream& out)
+{
+    Compiler compiler;
+    std::string const& data = compiler.finish(node);
+    out.write(data.data(), data.size());
+}
+
+void Snapshot::write(Node const* node, std::string const& file, int flags)
+{
+    Compiler compiler;
+    std::string const& data = compiler.finish(node);
+    writeFile(file, data.data(), data.size(), flags);
+}
+
+void Snapshot::M_check()
+{
+    if (m_size < sizeof(Header) || (uintptr_t) m_data % 8)
+        throw std::logic_error("json::Snapshot: invalid snapshot");
+
+    Header const* header = (Header const*) m_data;
+    if (std::memcmp(header->magic, magic, 4))
+        throw std::logic_error("json::Snapshot: bad magic number");
+    if (header->endianness != endianness)
+        throw std::logic_error("json::Snapshot: snapshot has a different byte order");
+    if (header->size != m_size)
+        throw std::logic_error("json::Snapshot: truncated snapshot");
+}
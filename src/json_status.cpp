@@ -0,0 +1,107 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_status.h"
+#include "lconf/json_template.h"
+#include "lconf/json_path.h"
+#include <stdexcept>
+#include <sstream>
+
+using namespace lconf;
+using namespace json;
+
+Status::Status() :
+    code(Ok),
+    line(0),
+    column(0),
+    node(0)
+{}
+
+bool Status::ok() const
+{ return code == Ok; }
+
+void Status::clear()
+{
+    code = Ok;
+    message.clear();
+    line = column = 0;
+    path.clear();
+    node = 0;
+}
+
+bool Status::fail(Code code, std::string const& message, Node* node)
+{
+    this->code = code;
+    this->message = message;
+    this->line = this->column = 0;
+    this->path.clear();
+    this->node = node;
+    return false;
+}
+
+bool Status::fail(std::size_t line, std::size_t column, std::string const& message)
+{
+    std::ostringstream ss;
+    ss << "json::Parser::M_error: [" << line << ":" << column << "]: " << message;
+
+    fail(SyntaxError, ss.str());
+    this->line = line;
+    this->column = column;
+    return false;
+}
+
+void Status::prefix(std::string const& key)
+{ path.insert(0, "/" + Path::escape(key)); }
+
+void Status::prefix(std::size_t index)
+{
+    std::ostringstream ss;
+    ss << "/" << index;
+    path.insert(0, ss.str());
+}
+
+void Status::raise() const
+{
+    switch (code)
+    {
+        case Ok:
+            return;
+
+        case IoError:
+        case SyntaxError:
+            throw std::logic_error(message);
+
+        default:
+            throw Exception(node, message);
+    }
+}
+
+namespace lconf { namespace json
+{
+    void prefix(std::vector<Status>& errors, std::size_t first, std::string const& key)
+    {
+        for (std::size_t i = first; i < errors.size(); ++i)
+            errors[i].prefix(key);
+    }
+
+    void prefix(std::vector<Status>& errors, std::size_t first, std::size_t index)
+    {
+        for (std::size_t i = first; i < errors.size(); ++i)
+            errors[i].prefix(index);
+    }
+} }
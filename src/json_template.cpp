@@ -18,6 +18,7 @@
 
 #include "lconf/json_template.h"
 #include <stdexcept>
+#include <cstring>
 
 using namespace lconf;
 using namespace json;
@@ -37,6 +38,113 @@ Element::Element() :
 Element::~Element()
 {}
 
+void Element::write(Writer& out) const
+{
+    Node* node = synthetize();
+    try
+    {
+        out.node(node);
+    }
+    catch (...)
+    {
+        delete node;
+        throw;
+    }
+    delete node;
+}
+
+bool Element::extract(Node* node, Status& status) const
+{
+    try
+    {
+        extract(node);
+        return true;
+    }
+    catch (Exception const& e)
+    {
+        return status.fail(Status::UserError, e.what(), e.node());
+    }
+    catch (std::logic_error const& e)
+    {
+        return status.fail(Status::UserError, e.what(), node);
+    }
+}
+
+bool Element::extract(Node* node, std::vector<Status>& errors) const
+{
+    Status status;
+    if (extract(node, status))
+        return true;
+
+    errors.push_back(status);
+    return false;
+}
+
+void Element::M_extractOrThrow(Node* node) const
+{
+    Status status;
+    if (!extract(node, status))
+        status.raise();
+}
+
+void Element::extract(View const& view) const
+{
+    Node* node = view.materialize();
+    try
+    {
+        extract(node);
+    }
+    catch (...)
+    {
+        delete node;
+        throw;
+    }
+    delete node;
+}
+
+void Element::write(Writer& out, Fragment&, std::string const&) const
+{ write(out); }
+
+void Element::M_write(Writer& out, Fragment& fragment, std::string const& previous,
+                      void const* data, std::size_t size) const
+{
+    // Leaves are single-line values
+    out.prefix(false);
+    std::size_t begin = out.position();
+
+    if (fragment.valid && fragment.shadow.size() == size &&
+        (!size || !std::memcmp(fragment.shadow.data(), data, size)))
+    {
+        out.splice(previous.data() + fragment.begin, fragment.end - fragment.begin);
+    }
+    else
+    {
+        write(out);
+        fragment.shadow.assign((char const*) data, size);
+        fragment.valid = true;
+    }
+
+    fragment.begin = begin;
+    fragment.end = out.position();
+}
+
+bool Element::multiline() const
+{
+    // Objects always span multiple lines, and scalars never do
+    switch (type())
+    {
+        case Scalar: return false;
+        case Object: case Map: return true;
+        default: break;
+    }
+
+    // Otherwise it depends on the contents
+    Node* node = synthetize();
+    bool multiline = node->multiline();
+    delete node;
+    return multiline;
+}
+
 Object::Object()
 {}
 
@@ -63,18 +171,65 @@ Element::Type Object::type() const
 { return Element::Object; }
 
 void Object::extract(Node* node) const
+{ M_extractOrThrow(node); }
+
+bool Object::extract(Node* node, Status& status) const
 {
     if (node->type() != Node::Object)
-        throw Exception(node, "json::Object::extract: type mismatch");
-    ObjectNode* obj = node->downcast<ObjectNode>();
+        return status.fail(Status::TypeError, "json::Object::extract: type mismatch", node);
+    ObjectNode const* obj = node->downcast<ObjectNode>();
     
     for (std::map<std::string, Element*>::const_iterator it = m_elements.begin();
          it != m_elements.end(); ++it)
     {
         if (!obj->exists(it->first))
-            throw Exception(node, "json::Object::extract: missing element `" + it->first + "'");
+            status.fail(Status::TypeError, "json::Object::extract: missing element `" + it->first + "'", node);
+        else if (it->second->extract(obj->get(it->first), status))
+            continue;
+
+        status.prefix(it->first);
+        return false;
+    }
+    return true;
+}
+
+bool Object::extract(Node* node, std::vector<Status>& errors) const
+{
+    if (node->type() != Node::Object)
+        return Element::extract(node, errors);
+    ObjectNode const* obj = node->downcast<ObjectNode>();
+    std::size_t first = errors.size();
+    
+    for (std::map<std::string, Element*>::const_iterator it = m_elements.begin();
+         it != m_elements.end(); ++it)
+    {
+        std::size_t mark = errors.size();
+        if (!obj->exists(it->first))
+        {
+            errors.push_back(Status());
+            errors.back().fail(Status::TypeError, "json::Object::extract: missing element `" + it->first + "'", node);
+        }
+        else
+            it->second->extract(obj->get(it->first), errors);
         
-        it->second->extract(obj->get(it->first));
+        prefix(errors, mark, it->first);
+    }
+    return errors.size() == first;
+}
+
+void Object::extract(View const& view) const
+{
+    if (view.type() != Node::Object)
+        throw Exception(0, "json::Object::extract: type mismatch");
+    
+    for (std::map<std::string, Element*>::const_iterator it = m_elements.begin();
+         it != m_elements.end(); ++it)
+    {
+        View value;
+        if (!view.find(it->first, value))
+            throw Exception(0, "json::Object::extract: missing element `" + it->first + "'");
+        
+        it->second->extract(value);
     }
 }
 
@@ -92,6 +247,35 @@ Node* Object::synthetize() const
 bool Object::isConst() const
 { return false; }
 
+void Object::write(Writer& out) const
+{
+    out.beginObject();
+    for (std::map<std::string, Element*>::const_iterator it = m_elements.begin();
+         it != m_elements.end(); ++it)
+    {
+        out.key(it->first);
+        it->second->write(out);
+    }
+    out.endObject();
+}
+
+void Object::write(Writer& out, Fragment& fragment, std::string const& previous) const
+{
+    fragment.children.resize(m_elements.size());
+    out.beginObject();
+    std::size_t i = 0;
+    for (std::map<std::string, Element*>::const_iterator it = m_elements.begin();
+         it != m_elements.end(); ++it, ++i)
+    {
+        out.key(it->first);
+        it->second->write(out, fragment.children[i], previous);
+    }
+    out.endObject();
+}
+
+bool Object::multiline() const
+{ return true; }
+
 Array::Array()
 {}
 
@@ -114,17 +298,61 @@ Element::Type Array::type() const
 { return Element::Array; }
     
 void Array::extract(Node* node) const
+{ M_extractOrThrow(node); }
+
+bool Array::extract(Node* node, Status& status) const
+{
+    if (node->type() != Node::Array)
+        return status.fail(Status::TypeError, "json::Array::extract: type mismatch", node);
+    ArrayNode const* arr = node->downcast<ArrayNode>();
+    
+    for (unsigned int i = 0; i < m_elements.size(); ++i)
+    {
+        if (i >= arr->size())
+            status.fail(Status::TypeError, "json::Array::extract: size mismatch in array", node);
+        else if (m_elements[i]->extract(arr->at(i), status))
+            continue;
+
+        status.prefix(i);
+        return false;
+    }
+    return true;
+}
+
+bool Array::extract(Node* node, std::vector<Status>& errors) const
 {
     if (node->type() != Node::Array)
-        throw Exception(node, "json::Array::extract: type mismatch");
-    ArrayNode* arr = node->downcast<ArrayNode>();
+        return Element::extract(node, errors);
+    ArrayNode const* arr = node->downcast<ArrayNode>();
+    std::size_t first = errors.size();
     
     for (unsigned int i = 0; i < m_elements.size(); ++i)
     {
+        std::size_t mark = errors.size();
         if (i >= arr->size())
-            throw Exception(node, "json::Array::extract: size mismatch in array");
+        {
+            errors.push_back(Status());
+            errors.back().fail(Status::TypeError, "json::Array::extract: size mismatch in array", node);
+        }
+        else
+            m_elements[i]->extract(arr->at(i), errors);
+        
+        prefix(errors, mark, (std::size_t) i);
+    }
+    return errors.size() == first;
+}
+
+void Array::extract(View const& view) const
+{
+    if (view.type() != Node::Array)
+        throw Exception(0, "json::Array::extract: type mismatch");
+    
+    for (unsigned int i = 0; i < m_elements.size(); ++i)
+    {
+        if (i >= view.size())
+            throw Exception(0, "json::Array::extract: size mismatch in array");
         
-        m_elements[i]->extract(arr->at(i));
+        m_elements[i]->extract(view.at(i));
     }
 }
 
@@ -141,6 +369,33 @@ Node* Array::synthetize() const
 bool Array::isConst() const
 { return false; }
 
+void Array::write(Writer& out) const
+{
+    out.beginArray(multiline());
+    for (unsigned int i = 0; i < m_elements.size(); ++i)
+        m_elements[i]->write(out);
+    out.endArray();
+}
+
+void Array::write(Writer& out, Fragment& fragment, std::string const& previous) const
+{
+    fragment.children.resize(m_elements.size());
+    out.beginArray(multiline());
+    for (unsigned int i = 0; i < m_elements.size(); ++i)
+        m_elements[i]->write(out, fragment.children[i], previous);
+    out.endArray();
+}
+
+bool Array::multiline() const
+{
+    for (unsigned int i = 0; i < m_elements.size(); ++i)
+    {
+        if (m_elements[i]->multiline())
+            return true;
+    }
+    return false;
+}
+
 Template::Template() :
     m_impl(0)
 {}
@@ -204,10 +459,55 @@ void Template::extract(Node* node) const
     m_impl->extract(node);
 }
 
+bool Template::extract(Node* node, Status& status) const
+{
+    if (!m_impl)
+        return status.fail(Status::BindingError, "json::Template::extract: template is not bound !", node);
+    
+    status.clear();
+    return m_impl->extract(node, status);
+}
+
+bool Template::extract(Node* node, std::vector<Status>& errors) const
+{
+    errors.clear();
+    if (!m_impl)
+    {
+        errors.push_back(Status());
+        return errors.back().fail(Status::BindingError, "json::Template::extract: template is not bound !", node);
+    }
+    
+    return m_impl->extract(node, errors);
+}
+
+void Template::extract(View const& view) const
+{
+    if (!m_impl)
+        throw Exception(0, "json::Template::extract: template is not bound !");
+    
+    m_impl->extract(view);
+}
+
 Node* Template::synthetize() const
 {
     if (!m_impl)
         throw std::logic_error("json::Template::synthetize: template is not bound !");
     
     return m_impl->synthetize();
-}
\ No newline at end of file
+}
+
+void Template::write(Writer& out) const
+{
+    if (!m_impl)
+        throw std::logic_error("json::Template::write: template is not bound !");
+    
+    m_impl->write(out);
+}
+
+void Template::write(Writer& out, Fragment& fragment, std::string const& previous) const
+{
+    if (!m_impl)
+        throw std::logic_error("json::Template::write: template is not bound !");
+    
+    m_impl->write(out, fragment, previous);
+}
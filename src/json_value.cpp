@@ -0,0 +1,828 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_value.h"
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+
+using namespace lconf;
+using namespace json;
+
+namespace
+{
+    typedef std::pair<std::string, Value> Entry;
+
+    //! Maximum number of items (or children) of a chunk.
+    std::size_t const chunkSize = 32;
+
+    //! A node of a persistent B-tree : leaves hold up to chunkSize
+    //!   items, inner chunks up to chunkSize children. Chunks are
+    //!   never modified once shared.
+    template <typename T>
+    struct Chunk
+    {
+        typedef std::shared_ptr<Chunk const> Ptr;
+
+        Chunk() :
+            size(0)
+        {}
+
+        //! Number of items in this subtree.
+        std::size_t size;
+        std::vector<T> items;
+        std::vector<Ptr> children;
+    };
+
+    //! A persistent sequence of items, indexed by position.
+    //! Updates copy the chunks on the path to the updated item
+    //!   (chunkSize items or pointers per level) and share the rest,
+    //!   so they cost O(log N) instead of a copy of the whole
+    //!   sequence.
+    //! Removing items does not merge underfull chunks, so the height
+    //!   stays bounded by the largest size the sequence had.
+    template <typename T>
+    class Tree
+    {
+    public:
+        typedef Chunk<T> Type;
+        typedef typename Type::Ptr Ptr;
+
+        //! Build a sequence from items, which are moved.
+        static Tree build(std::vector<T>& items)
+        {
+            Tree tree;
+            if (items.empty())
+                return tree;
+
+            std::vector<Ptr> level;
+            for (std::size_t i = 0; i < items.size(); i += chunkSize)
+            {
+                std::shared_ptr<Type> leaf = std::make_shared<Type>();
+                leaf->items.assign(std::make_move_iterator(items.begin() + i),
+                    std::make_move_iterator(items.begin() + std::min(items.size(), i + chunkSize)));
+                leaf->size = leaf->items.size();
+                level.push_back(leaf);
+            }
+
+            while (level.size() > 1)
+            {
+                std::vector<Ptr> parents;
+                for (std::size_t i = 0; i < level.size(); i += chunkSize)
+                {
+                    std::shared_ptr<Type> parent = std::make_shared<Type>();
+                    parent->children.assign(level.begin() + i, level.begin() + std::min(level.size(), i + chunkSize));
+                    parent->size = M_size(parent->children);
+                    parents.push_back(parent);
+                }
+                level.swap(parents);
+            }
+
+            tree.m_root = level[0];
+            return tree;
+        }
+
+        std::size_t size() const
+        { return m_root ? m_root->size : 0; }
+
+        T const& at(std::size_t i) const
+        {
+            Type const* chunk = m_root.get();
+            while (!chunk->children.empty())
+                chunk = chunk->children[M_child(*chunk, i, false)].get();
+            return chunk->items[i];
+        }
+
+        //! Append pointers to all the items, in order, to out.
+        void list(std::vector<T const*>& out) const
+        {
+            out.reserve(out.size() + size());
+            if (m_root)
+                M_list(*m_root, out);
+        }
+
+        Tree set(std::size_t i, T const& item) const
+        {
+            Tree tree;
+            tree.m_root = M_set(*m_root, i, item);
+            return tree;
+        }
+
+        Tree insert(std::size_t i, T const& item) const
+        {
+            Tree tree;
+            if (!m_root)
+            {
+                std::shared_ptr<Type> leaf = std::make_shared<Type>();
+                leaf->items.push_back(item);
+                leaf->size = 1;
+                tree.m_root = leaf;
+                return tree;
+            }
+
+            Ptr right;
+            Ptr left = M_insert(*m_root, i, item, right);
+            if (right)
+            {
+                // The root was split, grow the tree by one level
+                std::shared_ptr<Type> root = std::make_shared<Type>();
+                root->children.push_back(left);
+                root->children.push_back(right);
+                root->size = left->size + right->size;
+                tree.m_root = root;
+            }
+            else
+                tree.m_root = left;
+            return tree;
+        }
+
+        Tree erase(std::size_t i) const
+        {
+            Tree tree;
+            tree.m_root = M_erase(*m_root, i);
+            while (tree.m_root && tree.m_root->children.size() == 1)
+                tree.m_root = tree.m_root->children[0];
+            return tree;
+        }
+
+    private:
+        static std::size_t M_size(std::vector<Ptr> const& children)
+        {
+            std::size_t size = 0;
+            for (std::size_t i = 0; i < children.size(); ++i)
+                size += children[i]->size;
+            return size;
+        }
+
+        //! Find the child of chunk holding the item at position i, and
+        //!   make i relative to it. When inserting, a position just
+        //!   past the end of a child belongs to that child.
+        static std::size_t M_child(Type const& chunk, std::size_t& i, bool insert)
+        {
+            std::size_t c = 0;
+            while (c + 1 < chunk.children.size() &&
+                   (insert ? i > chunk.children[c]->size : i >= chunk.children[c]->size))
+                i -= chunk.children[c++]->size;
+            return c;
+        }
+
+        static void M_list(Type const& chunk, std::vector<T const*>& out)
+        {
+            for (std::size_t i = 0; i < chunk.items.size(); ++i)
+                out.push_back(&chunk.items[i]);
+            for (std::size_t i = 0; i < chunk.children.size(); ++i)
+                M_list(*chunk.children[i], out);
+        }
+
+        static Ptr M_set(Type const& chunk, std::size_t i, T const& item)
+        {
+            std::shared_ptr<Type> copy = std::make_shared<Type>(chunk);
+            if (chunk.children.empty())
+                copy->items[i] = item;
+            else
+            {
+                std::size_t c = M_child(chunk, i, false);
+                copy->children[c] = M_set(*chunk.children[c], i, item);
+            }
+            return copy;
+        }
+
+        //! Insert item at position i in a copy of chunk. If the copy
+        //!   overflows, its upper half is moved to right.
+        static Ptr M_insert(Type const& chunk, std::size_t i, T const& item, Ptr& right)
+        {
+            std::shared_ptr<Type> copy = std::make_shared<Type>(chunk);
+            if (chunk.children.empty())
+            {
+                copy->items.insert(copy->items.begin() + i, item);
+                copy->size = copy->items.size();
+                if (copy->items.size() > chunkSize)
+                {
+                    std::shared_ptr<Type> split = std::make_shared<Type>();
+                    split->items.assign(copy->items.begin() + copy->items.size() / 2, copy->items.end());
+                    split->size = split->items.size();
+                    copy->items.resize(copy->items.size() / 2);
+                    copy->size = copy->items.size();
+                    right = split;
+                }
+            }
+            else
+            {
+                std::size_t c = M_child(chunk, i, true);
+                Ptr childRight;
+                copy->children[c] = M_insert(*chunk.children[c], i, item, childRight);
+                if (childRight)
+                    copy->children.insert(copy->children.begin() + c + 1, childRight);
+                copy->size = chunk.size + 1;
+                if (copy->children.size() > chunkSize)
+                {
+                    std::shared_ptr<Type> split = std::make_shared<Type>();
+                    split->children.assign(copy->children.begin() + copy->children.size() / 2, copy->children.end());
+                    split->size = M_size(split->children);
+                    copy->children.resize(copy->children.size() / 2);
+                    copy->size -= split->size;
+                    right = split;
+                }
+            }
+            return copy;
+        }
+
+        //! Remove the item at position i from a copy of chunk, or
+        //!   return null if nothing is left of it.
+        static Ptr M_erase(Type const& chunk, std::size_t i)
+        {
+            if (chunk.size == 1)
+                return Ptr();
+
+            std::shared_ptr<Type> copy = std::make_shared<Type>(chunk);
+            --copy->size;
+            if (chunk.children.empty())
+                copy->items.erase(copy->items.begin() + i);
+            else
+            {
+                std::size_t c = M_child(chunk, i, false);
+                Ptr child = M_erase(*chunk.children[c], i);
+                if (child)
+                    copy->children[c] = child;
+                else
+                    copy->children.erase(copy->children.begin() + c);
+            }
+            return copy;
+        }
+
+        Ptr m_root;
+    };
+}
+
+struct Value::Data
+{
+    Data(Node::Type type) :
+        type(type),
+        number(0),
+        single(false),
+        boolean(false)
+    {}
+
+    Node::Type type;
+    double number;
+    bool single;
+    bool boolean;
+    std::string string;
+    //! Object entries, sorted by key.
+    Tree<Entry> entries;
+    Tree<Value> elements;
+
+    //! Position of the first entry whose key is not less than key.
+    std::size_t lowerBound(std::string const& key) const
+    {
+        std::size_t first = 0, count = entries.size();
+        while (count)
+        {
+            std::size_t half = count / 2;
+            if (entries.at(first + half).first < key)
+            {
+                first += half + 1;
+                count -= half + 1;
+            }
+            else
+                count = half;
+        }
+        return first;
+    }
+};
+
+Value::Value()
+{}
+
+Value::Value(double value, bool single)
+{
+    std::shared_ptr<Data> data = std::make_shared<Data>(Node::Number);
+    data->number = value;
+    data->single = single;
+    m_data = data;
+}
+
+Value::Value(int value)
+{
+    std::shared_ptr<Data> data = std::make_shared<Data>(Node::Number);
+    data->number = value;
+    m_data = data;
+}
+
+Value::Value(bool value)
+{
+    std::shared_ptr<Data> data = std::make_shared<Data>(Node::Boolean);
+    data->boolean = value;
+    m_data = data;
+}
+
+Value::Value(std::string const& value)
+{
+    std::shared_ptr<Data> data = std::make_shared<Data>(Node::String);
+    data->string = value;
+    m_data = data;
+}
+
+Value::Value(char const* value)
+{
+    std::shared_ptr<Data> data = std::make_shared<Data>(Node::String);
+    data->string = value;
+    m_data = data;
+}
+
+Value::Value(Node const* node)
+{
+    switch (node->type())
+    {
+        case Node::Number:
+        {
+            NumberNode const* num = (NumberNode const*) node;
+            *this = Value(num->value(), num->isSingle());
+            break;
+        }
+
+        case Node::Boolean:
+            *this = Value(((BooleanNode const*) node)->value());
+            break;
+
+        case Node::String:
+            *this = Value(((StringNode const*) node)->value());
+            break;
+
+        case Node::Object:
+        {
+            std::map<std::string, Node*> const& impl = ((ObjectNode const*) node)->impl();
+            std::vector<Entry> entries;
+            entries.reserve(impl.size());
+            for (std::map<std::string, Node*>::const_iterator it = impl.begin(); it != impl.end(); ++it)
+                entries.push_back(Entry(it->first, Value(it->second)));
+
+            std::shared_ptr<Data> data = std::make_shared<Data>(Node::Object);
+            data->entries = Tree<Entry>::build(entries);
+            m_data = data;
+            break;
+        }
+
+        case Node::Array:
+        {
+            ArrayNode const* arr = (ArrayNode const*) node;
+            std::vector<Value> elements;
+            elements.reserve(arr->size());
+
+            // Packed arrays are read without unpacking them
+            if (arr->storage() == ArrayNode::Numbers)
+            {
+                std::vector<double> const& values = arr->numbers();
+                for (std::size_t i = 0; i < values.size(); ++i)
+                    elements.push_back(Value(values[i], arr->isSingle()));
+            }
+            else if (arr->storage() == ArrayNode::Booleans)
+            {
+                std::vector<bool> const& values = arr->booleans();
+                for (std::size_t i = 0; i < values.size(); ++i)
+                    elements.push_back(Value((bool) values[i]));
+            }
+            else
+            {
+                std::vector<Node*> const& impl = arr->impl();
+                for (std::size_t i = 0; i < impl.size(); ++i)
+                    elements.push_back(Value(impl[i]));
+            }
+
+            std::shared_ptr<Data> data = std::make_shared<Data>(Node::Array);
+            data->elements = Tree<Value>::build(elements);
+            m_data = data;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+Value::Value(std::shared_ptr<Data const> const& data) :
+    m_data(data)
+{}
+
+Value Value::object()
+{
+    return Value(std::make_shared<Data>(Node::Object));
+}
+
+Value Value::array()
+{
+    return Value(std::make_shared<Data>(Node::Array));
+}
+
+Node::Type Value::type() const
+{
+    return m_data ? m_data->type : Node::Null;
+}
+
+double Value::number() const
+{
+    return M_data(Node::Number, "number").number;
+}
+
+bool Value::isSingle() const
+{
+    return M_data(Node::Number, "isSingle").single;
+}
+
+bool Value::boolean() const
+{
+    return M_data(Node::Boolean, "boolean").boolean;
+}
+
+std::string const& Value::string() const
+{
+    return M_data(Node::String, "string").string;
+}
+
+std::size_t Value::size() const
+{
+    if (type() == Node::Object)
+        return m_data->entries.size();
+    else if (type() == Node::Array)
+        return m_data->elements.size();
+    return 0;
+}
+
+std::string const& Value::key(std::size_t i) const
+{
+    Data const& data = M_data(Node::Object, "key");
+    if (i >= data.entries.size())
+        throw std::domain_error("json::Value::key: index out of bounds");
+    return data.entries.at(i).first;
+}
+
+bool Value::exists(std::string const& key) const
+{
+    return M_entry(key) != 0;
+}
+
+Value Value::get(std::string const& key) const
+{
+    Value const* value = M_entry(key);
+    if (!value)
+        throw std::domain_error("json::Value::get: no such key \"" + key + "\"");
+    return *value;
+}
+
+Value Value::at(std::size_t i) const
+{
+    if (type() == Node::Object && i < m_data->entries.size())
+        return m_data->entries.at(i).second;
+    else if (type() == Node::Array && i < m_data->elements.size())
+        return m_data->elements.at(i);
+    throw std::domain_error("json::Value::at: index out of bounds");
+}
+
+bool Value::find(Path const& path, Value& value) const
+{
+    if (!path.isPointer())
+        throw std::logic_error("json::Value::find: \"" + path.str() + "\" is not a plain pointer");
+
+    Value current = *this;
+    for (std::size_t i = 0; i < path.size(); ++i)
+    {
+        if (current.type() == Node::Object)
+        {
+            Value const* entry = current.M_entry(path.key(i));
+            if (!entry)
+                return false;
+            current = *entry;
+        }
+        else if (current.type() == Node::Array && path.isIndex(i) && path.index(i) < current.size())
+            current = current.m_data->elements.at(path.index(i));
+        else
+            return false;
+    }
+
+    value = current;
+    return true;
+}
+
+Value Value::set(std::string const& key, Value const& value) const
+{
+    Data const& data = M_data(Node::Object, "set");
+    std::size_t i = data.lowerBound(key);
+    bool found = i < data.entries.size() && data.entries.at(i).first == key;
+    if (found && data.entries.at(i).second.same(value))
+        return *this;
+
+    std::shared_ptr<Data> copy = std::make_shared<Data>(Node::Object);
+    copy->entries = found ? data.entries.set(i, Entry(key, value)) : data.entries.insert(i, Entry(key, value));
+    return Value(copy);
+}
+
+Value Value::remove(std::string const& key) const
+{
+    Data const& data = M_data(Node::Object, "remove");
+    std::size_t i = data.lowerBound(key);
+    if (i == data.entries.size() || data.entries.at(i).first != key)
+        return *this;
+
+    std::shared_ptr<Data> copy = std::make_shared<Data>(Node::Object);
+    copy->entries = data.entries.erase(i);
+    return Value(copy);
+}
+
+Value Value::set(std::size_t i, Value const& value) const
+{
+    Data const& data = M_data(Node::Array, "set");
+    if (i >= data.elements.size())
+        throw std::domain_error("json::Value::set: index out of bounds");
+    if (data.elements.at(i).same(value))
+        return *this;
+
+    std::shared_ptr<Data> copy = std::make_shared<Data>(Node::Array);
+    copy->elements = data.elements.set(i, value);
+    return Value(copy);
+}
+
+Value Value::remove(std::size_t i) const
+{
+    Data const& data = M_data(Node::Array, "remove");
+    if (i >= data.elements.size())
+        throw std::domain_error("json::Value::remove: index out of bounds");
+
+    std::shared_ptr<Data> copy = std::make_shared<Data>(Node::Array);
+    copy->elements = data.elements.erase(i);
+    return Value(copy);
+}
+
+Value Value::append(Value const& value) const
+{
+    Data const& data = M_data(Node::Array, "append");
+    std::shared_ptr<Data> copy = std::make_shared<Data>(Node::Array);
+    copy->elements = data.elements.insert(data.elements.size(), value);
+    return Value(copy);
+}
+
+Value Value::set(Path const& path, Value const& value) const
+{
+    if (!path.isPointer())
+        throw std::logic_error("json::Value::set: \"" + path.str() + "\" is not a plain pointer");
+    return M_set(path, 0, value);
+}
+
+Value Value::remove(Path const& path) const
+{
+    if (!path.isPointer())
+        throw std::logic_error("json::Value::remove: \"" + path.str() + "\" is not a plain pointer");
+    if (!path.size())
+        throw std::logic_error("json::Value::remove: can not remove the whole document");
+    return M_remove(path, 0);
+}
+
+bool Value::same(Value const& other) const
+{
+    return m_data == other.m_data;
+}
+
+Node* Value::node() const
+{
+    switch (type())
+    {
+        case Node::Number:
+            return new NumberNode(m_data->number, m_data->single);
+
+        case Node::Boolean:
+            return new BooleanNode(m_data->boolean);
+
+        case Node::String:
+            return new StringNode(m_data->string);
+
+        case Node::Object:
+        {
+            ObjectNode* obj = new ObjectNode();
+            try
+            {
+                std::vector<Entry const*> entries;
+                m_data->entries.list(entries);
+
+                std::map<std::string, Node*>& impl = obj->impl();
+                for (std::size_t i = 0; i < entries.size(); ++i)
+                    impl.insert(impl.end(), std::make_pair(entries[i]->first, entries[i]->second.node()));
+            }
+            catch (...)
+            {
+                delete obj;
+                throw;
+            }
+            return obj;
+        }
+
+        case Node::Array:
+        {
+            std::vector<Value const*> elements;
+            m_data->elements.list(elements);
+
+            // Pack homogeneous arrays of numbers or booleans,
+            //   as the parser does
+            bool numbers = !elements.empty(), booleans = !elements.empty();
+            for (std::size_t i = 0; i < elements.size(); ++i)
+            {
+                numbers = numbers && elements[i]->type() == Node::Number &&
+                    elements[i]->m_data->single == elements[0]->m_data->single;
+                booleans = booleans && elements[i]->type() == Node::Boolean;
+            }
+
+            if (numbers)
+            {
+                ArrayNode* arr = new ArrayNode(ArrayNode::Numbers);
+                arr->setSingle(elements[0]->m_data->single);
+                arr->numbers().reserve(elements.size());
+                for (std::size_t i = 0; i < elements.size(); ++i)
+                    arr->numbers().push_back(elements[i]->m_data->number);
+                return arr;
+            }
+            else if (booleans)
+            {
+                ArrayNode* arr = new ArrayNode(ArrayNode::Booleans);
+                arr->booleans().reserve(elements.size());
+                for (std::size_t i = 0; i < elements.size(); ++i)
+                    arr->booleans().push_back(elements[i]->m_data->boolean);
+                return arr;
+            }
+
+            ArrayNode* arr = new ArrayNode();
+            try
+            {
+                std::vector<Node*>& impl = arr->impl();
+                impl.reserve(elements.size());
+                for (std::size_t i = 0; i < elements.size(); ++i)
+                    impl.push_back(elements[i]->node());
+            }
+            catch (...)
+            {
+                delete arr;
+                throw;
+            }
+            return arr;
+        }
+
+        default:
+            return new NullNode();
+    }
+}
+
+void Value::write(Writer& out) const
+{
+    switch (type())
+    {
+        case Node::Number:
+            out.value(m_data->number, m_data->single);
+            break;
+
+        case Node::Boolean:
+            out.value(m_data->boolean);
+            break;
+
+        case Node::String:
+            out.value(m_data->string);
+            break;
+
+        case Node::Object:
+        {
+            std::vector<Entry const*> entries;
+            m_data->entries.list(entries);
+
+            out.beginObject();
+            for (std::size_t i = 0; i < entries.size(); ++i)
+            {
+                out.key(entries[i]->first);
+                entries[i]->second.write(out);
+            }
+            out.endObject();
+            break;
+        }
+
+        case Node::Array:
+        {
+            std::vector<Value const*> elements;
+            m_data->elements.list(elements);
+
+            out.beginArray(M_multiline());
+            for (std::size_t i = 0; i < elements.size(); ++i)
+                elements[i]->write(out);
+            out.endArray();
+            break;
+        }
+
+        default:
+            out.null();
+            break;
+    }
+}
+
+void Value::serialize(std::ostream& out, bool indent) const
+{
+    Buffer buffer(out);
+    Writer writer(buffer, indent);
+    write(writer);
+    buffer.flush();
+}
+
+void Value::serialize(std::ostream& out, Format format) const
+{
+    Buffer buffer(out);
+    Writer writer(buffer, format);
+    write(writer);
+    buffer.flush();
+}
+
+Value::Data const& Value::M_data(Node::Type type, char const* what) const
+{
+    if (this->type() != type)
+        throw std::domain_error(std::string("json::Value::") + what + ": value is not of type " + Node::typeName(type));
+    return *m_data;
+}
+
+Value const* Value::M_entry(std::string const& key) const
+{
+    if (type() != Node::Object)
+        return 0;
+
+    std::size_t i = m_data->lowerBound(key);
+    if (i == m_data->entries.size() || m_data->entries.at(i).first != key)
+        return 0;
+    return &m_data->entries.at(i).second;
+}
+
+//! Same as Node::multiline().
+bool Value::M_multiline() const
+{
+    if (type() == Node::Object)
+        return true;
+    if (type() != Node::Array)
+        return false;
+
+    std::vector<Value const*> elements;
+    m_data->elements.list(elements);
+    for (std::size_t i = 0; i < elements.size(); ++i)
+        if (elements[i]->M_multiline())
+            return true;
+    return false;
+}
+
+Value Value::M_set(Path const& path, std::size_t i, Value const& value) const
+{
+    if (i == path.size())
+        return value;
+
+    bool last = i + 1 == path.size();
+    if (type() == Node::Object)
+    {
+        if (last)
+            return set(path.key(i), value);
+
+        Value const* entry = M_entry(path.key(i));
+        if (entry)
+            return set(path.key(i), entry->M_set(path, i + 1, value));
+    }
+    else if (type() == Node::Array)
+    {
+        if (last && (path.key(i) == "-" || (path.isIndex(i) && path.index(i) == size())))
+            return append(value);
+
+        if (path.isIndex(i) && path.index(i) < size())
+            return set(path.index(i), m_data->elements.at(path.index(i)).M_set(path, i + 1, value));
+    }
+
+    throw std::logic_error("json::Value::set: no such value \"" + path.str() + "\"");
+}
+
+Value Value::M_remove(Path const& path, std::size_t i) const
+{
+    bool last = i + 1 == path.size();
+    if (type() == Node::Object)
+    {
+        Value const* entry = M_entry(path.key(i));
+        if (entry)
+            return last ? remove(path.key(i)) : set(path.key(i), entry->M_remove(path, i + 1));
+    }
+    else if (type() == Node::Array && path.isIndex(i) && path.index(i) < size())
+    {
+        std::size_t index = path.index(i);
+        return last ? remove(index) : set(index, m_data->elements.at(index).M_remove(path, i + 1));
+    }
+
+    throw std::logic_error("json::Value::remove: no such value \"" + path.str() + "\"");
+}
@@ -0,0 +1,242 @@
+/* This file is part of libconf.
+ *
+ * Copyright (c) 2015 - 2019, Alexandre Monti
+ *
+ * libconf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libconf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libconf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lconf/json_writer.h"
+#include "lconf/json_node.h"
+#include <stdexcept>
+#include <cstring>
+
+using namespace lconf;
+using namespace json;
+
+Writer::Writer(Buffer& out, bool indent) :
+    m_out(out),
+    m_indent(indent),
+    m_canonical(false),
+    m_prefixed(false),
+    m_prefixIndented(false),
+    m_prefixLevel(0)
+{}
+
+Writer::Writer(Buffer& out, Format format) :
+    m_out(out),
+    m_indent(format == Indented),
+    m_canonical(format == Canonical),
+    m_prefixed(false),
+    m_prefixIndented(false),
+    m_prefixLevel(0)
+{}
+
+Writer::~Writer()
+{}
+
+void Writer::beginObject()
+{
+    int level;
+    bool indented = M_beginValue(true, level);
+
+    m_out.put('{');
+    if (indented) m_out.put('\n');
+
+    Frame frame = { true, indented, level, 0 };
+    m_frames.push_back(frame);
+}
+
+void Writer::endObject()
+{
+    if (m_frames.empty() || !m_frames.back().object)
+        throw std::logic_error("json::Writer::endObject: no object to end");
+
+    Frame frame = m_frames.back();
+    m_frames.pop_back();
+
+    if (frame.multiline)
+    {
+        if (frame.count) m_out.put('\n');
+        m_out.indent(frame.level);
+    }
+    m_out.put('}');
+}
+
+void Writer::beginArray(bool multiline)
+{
+    int level;
+    bool indented = M_beginValue(multiline, level);
+    multiline = indented && multiline;
+
+    m_out.put('[');
+    if (multiline) m_out.put('\n');
+
+    Frame frame = { false, multiline, level, 0 };
+    m_frames.push_back(frame);
+}
+
+void Writer::endArray()
+{
+    if (m_frames.empty() || m_frames.back().object)
+        throw std::logic_error("json::Writer::endArray: no array to end");
+
+    Frame frame = m_frames.back();
+    m_frames.pop_back();
+
+    // Only multiline arrays have their closing bracket on its own line
+    if (frame.multiline)
+    {
+        if (frame.count) m_out.put('\n');
+        m_out.indent(frame.level);
+    }
+    m_out.put(']');
+}
+
+void Writer::key(std::string const& key)
+{
+    if (m_frames.empty() || !m_frames.back().object)
+        throw std::logic_error("json::Writer::key: not in an object");
+
+    Frame& frame = m_frames.back();
+    if (frame.count++)
+    {
+        if (m_canonical) m_out.put(',');
+        else m_out.write(", ", 2);
+        if (frame.multiline) m_out.put('\n');
+    }
+    if (frame.multiline) m_out.indent(frame.level + 4);
+
+    m_out.put('"');
+    m_out.escaped(key.data(), key.size());
+    if (m_canonical) m_out.write("\":", 2);
+    else m_out.write("\": ", 3);
+}
+
+void Writer::value(bool value)
+{
+    int level;
+    M_beginValue(false, level);
+
+    if (value) m_out.write("true", 4);
+    else m_out.write("false", 5);
+}
+
+void Writer::null()
+{
+    int level;
+    M_beginValue(false, level);
+
+    m_out.write("null", 4);
+}
+
+void Writer::value(std::string const& value)
+{ M_string(value.data(), value.size()); }
+
+void Writer::value(char const* value)
+{ M_string(value, std::strlen(value)); }
+
+void Writer::node(Node const* node)
+{ node->M_serialize(*this); }
+
+//! The prefix is written right away, and what M_beginValue() computed
+//!   is kept for the next value, which then writes no prefix of its own.
+void Writer::prefix(bool multiline)
+{
+    m_prefixIndented = M_beginValue(multiline, m_prefixLevel);
+    m_prefixed = true;
+}
+
+//! Cached values are written as is, after the prefix of a value
+//!   (unless prefix() already wrote it).
+void Writer::splice(char const* data, std::size_t size)
+{
+    if (!m_prefixed)
+    {
+        int level;
+        M_beginValue(false, level);
+    }
+    m_prefixed = false;
+    m_out.write(data, size);
+}
+
+//! Positions are counted from the start of the buffer, so that the
+//!   bytes of a value are found between two of them.
+std::size_t Writer::position() const
+{ return m_out.size(); }
+
+//! Write what comes before a value (separator, new line and indentation),
+//!   depending on the enclosing object or array.
+//! Returns true if the value is indented, at the given level (values
+//!   that are not indented are written in the compact form).
+bool Writer::M_beginValue(bool multiline, int& level)
+{
+    // Already done by prefix()
+    if (m_prefixed)
+    {
+        m_prefixed = false;
+        level = m_prefixLevel;
+        return m_prefixIndented;
+    }
+
+    level = 0;
+
+    // Top-level value
+    if (m_frames.empty())
+        return m_indent;
+
+    Frame& frame = m_frames.back();
+    level = frame.level + 4;
+
+    // Object entries go on their own line only if they span multiple
+    //   lines themselves (key() took care of the separator).
+    if (frame.object)
+    {
+        if (!frame.multiline || !multiline)
+            return false;
+
+        m_out.put('\n');
+        m_out.indent(level);
+        return true;
+    }
+
+    if (frame.count++)
+    {
+        if (m_canonical) m_out.put(',');
+        else m_out.write(", ", 2);
+        if (frame.multiline) m_out.put('\n');
+    }
+    if (frame.multiline) m_out.indent(level);
+    return frame.multiline;
+}
+
+void Writer::M_number(double value, bool single)
+{
+    int level;
+    M_beginValue(false, level);
+
+    if (m_canonical)
+        m_out.number(value == 0 ? 0.0 : value);
+    else
+        m_out.number(value, single);
+}
+
+void Writer::M_string(char const* value, std::size_t size)
+{
+    int level;
+    M_beginValue(false, level);
+
+    m_out.put('"');
+    m_out.escaped(value, size);
+    m_out.put('"');
+}
@@ -20,6 +20,8 @@
 #include "lconf/json_template.h"
 
 #include <sstream>
+#include <fstream>
+#include <cstdio>
 
 //! You can add custom loading rules as showed below.
 //! First, create a class inheriting the json::UserElement class (it
@@ -101,6 +103,31 @@ namespace lconf { namespace json
     };
 } }
 
+//! For plain structures, the LCONF_JSON_STRUCT() macro generates the
+//!   Terminal<> specialization from a compile-time list of fields.
+//! Structures declared this way can be nested, or used in STL containers.
+namespace app
+{
+    struct Point
+    {
+        float x, y;
+    };
+
+    struct Shape
+    {
+        std::string name;
+        std::vector<Point> points;
+    };
+}
+
+LCONF_JSON_STRUCT(app::Point,
+    LCONF_JSON_FIELD(x)
+    LCONF_JSON_FIELD(y))
+
+LCONF_JSON_STRUCT(app::Shape,
+    LCONF_JSON_FIELD(name)
+    LCONF_JSON_FIELD(points))
+
 int main()
 {
     using namespace lconf;
@@ -214,6 +241,42 @@ int main()
         std::cerr << "Exception:\n\t" << exc.what() << std::endl;
     }
 
+    // Structures
+
+    try
+    {
+        std::istringstream ss(
+        "{ \"shape\" : { \"name\" : \"triangle\", \"points\" : "
+        "[ { \"x\" : 0, \"y\" : 0 }, { \"x\" : 1, \"y\" : 0 }, { \"x\" : 0, \"y\" : 1 } ] } }");
+
+        app::Shape shape;
+
+        Template tpl = Template()
+        .bind("shape", shape);
+
+        json::extract(tpl, ss);
+
+        std::cout << "Read shape `" << shape.name << "' with " << shape.points.size() << " points" << std::endl;
+
+        shape.points.push_back(app::Point());
+        shape.points.back().x = 1;
+        shape.points.back().y = 1;
+
+        std::cout << "Serialized (indented version) :" << std::endl;
+        json::synthetize(tpl, std::cout);
+        std::cout << std::endl;
+    }
+    catch(Exception const& exc)
+    {
+        // Here you can retrieve the offending node :
+        Node* offending = exc.node();
+        std::cerr << "Exception:[" << offending << "]\n\t" << exc.what() << std::endl;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
     // PODs
 
     try
@@ -273,6 +336,14 @@ int main()
         std::cout << "Serialized (indented version) :" << std::endl;
         json::synthetize(tpl2, std::cout);
 
+        // Binary data can also be stored in base64, which
+        //   is more compact than the default hexadecimal.
+        Template tpl3 = Template()
+        .bind("data", ref_as_raw(raw2, sz, Base64));
+
+        std::cout << std::endl << "Serialized (base64) :" << std::endl;
+        json::synthetize(tpl3, std::cout);
+
         delete[] raw2;
     }
     catch(Exception const& exc)
@@ -286,5 +357,351 @@ int main()
         std::cerr << "Exception:\n\t" << exc.what() << std::endl;
     }
 
+    // Binary encoding
+
+    try
+    {
+        std::vector<double> values = { 0.5, 1.25, -3 };
+        std::string name = "binary";
+
+        Template tpl = Template()
+        .bind("values", values)
+        .bind("name", name);
+
+        // The binary form is smaller and much faster to load
+        //   than the text form, for the same tree.
+        std::stringstream ss;
+        json::synthetizeBinary(tpl, ss);
+        std::cout << std::endl << "Binary size : " << ss.str().size() << " bytes" << std::endl;
+
+        values.clear();
+        name.clear();
+        json::extractBinary(tpl, ss);
+
+        std::cout << "Read back :" << std::endl;
+        json::synthetize(tpl, std::cout);
+    }
+    catch(Exception const& exc)
+    {
+        // Here you can retrieve the offending node :
+        Node* offending = exc.node();
+        std::cerr << "Exception:[" << offending << "]\n\t" << exc.what() << std::endl;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Snapshots
+
+    try
+    {
+        std::vector<double> values = { 0.5, 1.25, -3 };
+        std::string name = "snapshot";
+
+        Template tpl = Template()
+        .bind("values", values)
+        .bind("name", name);
+
+        // Snapshots are usually written to a file and mapped with
+        //   Snapshot(file), they are then queried in place.
+        Node* node = tpl.synthetize();
+        std::ostringstream ss;
+        Snapshot::write(node, ss);
+        delete node;
+
+        std::string data = ss.str();
+        Snapshot snapshot(data.data(), data.size());
+        std::cout << std::endl << "Snapshot name : " << snapshot.root().get("name").string() << std::endl;
+
+        values.clear();
+        name.clear();
+        tpl.extract(snapshot.root());
+
+        std::cout << "Read back :" << std::endl;
+        json::synthetize(tpl, std::cout);
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Canonical output
+
+    try
+    {
+        // Keys are sorted, there is no space at all, and -0 is written as 0
+        std::istringstream in("{ \"zeta\": -0, \"alpha\": [1.5, true], \"mid\": { \"b\": null, \"a\": \"x\" } }");
+        Node* node = json::parse(in);
+        std::cout << std::endl << "Canonical : ";
+        node->serialize(std::cout, Canonical);
+        std::cout << std::endl;
+        delete node;
+
+        // Single precision is ignored : floats are written as the
+        //   shortest form of their double value
+        float ratio = 0.1f;
+        std::string name = "canonical";
+
+        Template tpl = Template()
+        .bind("ratio", ratio)
+        .bind("name", name);
+
+        std::cout << "Canonical template : ";
+        json::synthetize(tpl, std::cout, Canonical);
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Incremental synthetization
+
+    try
+    {
+        std::vector<double> samples = { 0.5, 1.25, -3 };
+        std::string status = "starting";
+        int count = 0;
+
+        Template tpl = Template()
+        .bind("samples", samples)
+        .bind("status", status)
+        .bind("count", count);
+
+        // Only the fields that changed since the previous
+        //   synthetization are formatted again.
+        Incremental state(tpl);
+        state.synthetize();
+
+        status = "running";
+        ++count;
+        std::cout << std::endl << "Rewritten state :" << std::endl;
+        state.synthetize(std::cout);
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Paths
+
+    try
+    {
+        std::istringstream ss("{ \"servers\": [ { \"name\": \"a\", \"port\": 80 },"
+                              " { \"name\": \"b\", \"port\": 8080 } ] }");
+        Node* node = json::parse(ss);
+
+        // Paths are compiled once, and can be evaluated many times
+        Path port("/servers/1/port");
+        Path named("/servers/?port=8080/name");
+        Path names("/**/name");
+
+        std::cout << std::endl << "Port of /servers/1 : ";
+        port.find(node)->serialize(std::cout);
+        std::cout << std::endl << "Server on port 8080 : ";
+        named.find(node)->serialize(std::cout);
+        std::cout << std::endl << "All names :";
+        std::vector<Node*> matches = names.select(node);
+        for (std::size_t i = 0; i < matches.size(); ++i)
+            std::cout << " " << ((StringNode*) matches[i])->value();
+        std::cout << std::endl;
+
+        // Indexes resolve pointers with a single lookup
+        Index index(node);
+        std::cout << "Indexed nodes : " << index.size() << ", /servers/0/name : ";
+        index.find("/servers/0/name")->serialize(std::cout);
+        std::cout << std::endl;
+
+        delete node;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Patches
+
+    try
+    {
+        std::istringstream from("{ \"level\": 1, \"tags\": [\"a\", \"b\"], \"old\": true }");
+        std::istringstream to("{ \"level\": 2, \"tags\": [\"a\"], \"new\": null }");
+        Node* a = json::parse(from);
+        Node* b = json::parse(to);
+
+        Node* ops = diff(a, b);
+        std::cout << std::endl << "Patch : ";
+        ops->serialize(std::cout, false);
+
+        a = patch(a, ops);
+        std::cout << std::endl << "Patched : ";
+        a->serialize(std::cout, false);
+        std::cout << std::endl << "Same hash : " << (a->hash() == b->hash())
+                  << ", equal : " << equal(a, b) << std::endl;
+
+        // Clones are deep copies, while shared nodes belong to several trees
+        Node* copy = a->clone();
+        ObjectNode* both = new ObjectNode();
+        both->get("copy") = copy;
+        both->get("shared") = b->share();
+        std::cout << "Cloned and shared : ";
+        both->serialize(std::cout, false);
+        std::cout << std::endl;
+
+        delete both;
+        delete ops;
+        delete a;
+        Node::release(b);
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Persistent values
+
+    try
+    {
+        std::istringstream ss("{ \"limits\": { \"cpu\": 2, \"memory\": 512 }, \"name\": \"v1\" }");
+        Node* node = json::parse(ss);
+        Value v1(node);
+        delete node;
+
+        // Updates return a new version, v1 is left untouched
+        Value v2 = v1.set(Path("/limits/cpu"), 4).set("name", "v2");
+
+        std::cout << std::endl << "Version 1 : ";
+        v1.serialize(std::cout, false);
+        std::cout << std::endl << "Version 2 : ";
+        v2.serialize(std::cout, false);
+        std::cout << std::endl;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Layers
+
+    try
+    {
+        std::istringstream defaults("{ \"log\": { \"level\": \"info\", \"file\": \"out.log\" }, \"plugins\": [\"core\"] }");
+        std::istringstream host("{ \"log\": { \"level\": \"debug\" }, \"plugins\": [\"extra\"] }");
+        Node* base = json::parse(defaults);
+        Node* top = json::parse(host);
+
+        Layers layers;
+        layers.push(base).push(top).strategy("/plugins", Layers::Append);
+        Node::release(base);
+        Node::release(top);
+
+        // Lookups go through the layers, without merging them
+        Overlay level;
+        layers.find(Path("/log/level"), level);
+        std::cout << std::endl << "Log level : ";
+        level.node()->serialize(std::cout);
+
+        Node* merged = layers.merge();
+        std::cout << std::endl << "Merged : ";
+        merged->serialize(std::cout, false);
+        std::cout << std::endl;
+        delete merged;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Error codes
+
+    try
+    {
+        std::vector<int> ports;
+        Template tpl;
+        tpl.bind("ports", Template(ports));
+
+        // Failures are reported without throwing
+        std::istringstream ss("{ \"ports\": [80, \"https\"] }");
+        Status status;
+        if (!json::tryExtract(tpl, ss, status))
+            std::cout << std::endl << "Rejected " << status.path << " : " << status.message << std::endl;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Validation
+
+    try
+    {
+        std::vector<int> ports;
+        std::string host;
+        Template tpl;
+        tpl.bind("ports", Template(ports)).bind("host", Template(host));
+
+        // All the errors are reported in a single pass
+        std::istringstream ss("{ \"ports\": [80, \"https\", 8080 8443], \"host\": 42 }");
+        std::vector<Status> errors;
+        json::validate(tpl, ss, errors);
+        std::cout << std::endl;
+        for (std::size_t i = 0; i < errors.size(); ++i)
+            std::cout << "Error at " << errors[i].line << ":" << errors[i].column << " "
+                      << errors[i].path << " : " << errors[i].message << std::endl;
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
+    // Cache
+
+    try
+    {
+        std::string dir = "/tmp/lconf-demo-cache";
+        std::string main = "/tmp/lconf-demo-main.json";
+        std::string inc = "/tmp/lconf-demo-inc.json";
+        std::string text = "{ \"name\": \"cached\", \"inc\": @\"" + inc + "\" }";
+
+        std::ofstream(inc.c_str()) << "{ \"level\": 1 }";
+        std::ofstream(main.c_str()) << text;
+
+        // Entries are named after the fingerprint of the main file
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx",
+                      (unsigned long long) json::fingerprint(text.data(), text.size()));
+        std::string entry = dir + "/" + name + ".lcc";
+
+        json::enableCache(dir);
+
+        // The first parse misses and writes the entry, the second one reads it back
+        Node* node = json::parse(main);
+        std::cout << std::endl << "Cache entry written : " << (std::ifstream(entry.c_str()) ? "yes" : "no") << std::endl;
+        delete node;
+
+        node = json::parse(main);
+        std::cout << "Cached : ";
+        node->serialize(std::cout, Canonical);
+        std::cout << std::endl;
+        delete node;
+
+        // Changing an included file invalidates the entry
+        std::ofstream(inc.c_str()) << "{ \"level\": 2 }";
+        node = json::parse(main);
+        std::cout << "Invalidated : ";
+        node->serialize(std::cout, Canonical);
+        std::cout << std::endl;
+        delete node;
+
+        json::disableCache();
+        std::remove(entry.c_str());
+        std::remove(dir.c_str());
+        std::remove(main.c_str());
+        std::remove(inc.c_str());
+    }
+    catch(std::exception const& exc)
+    {
+        std::cerr << "Exception:\n\t" << exc.what() << std::endl;
+    }
+
     return 0;
 }